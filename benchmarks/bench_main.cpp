@@ -0,0 +1,452 @@
+/** @file
+ *  Microbenchmarks comparing the wrapper against the raw SQLite C API
+ *
+ *  Every benchmark runs against an in-memory database so results reflect
+ *  CPU cost rather than disk latency. Each wrapper benchmark is paired with
+ *  a baseline doing the same work through sqlite3_* calls directly.
+ *
+ *  Allocations count both C++ heap allocations and SQLite's own calls to
+ *  malloc and realloc.
+ *
+ *  Usage: sqlite_cpp_bench [iterations] [filter]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+#include "sqlite_cpp.h"
+#include "sqlite_vtab.h"
+
+// Count every allocation made through operator new or by SQLite
+static std::atomic<size_t> allocations(0);
+
+static void* counted_new(size_t size, size_t alignment = 0) {
+    allocations++;
+    size = size ? size : 1;
+    void* ptr = alignment ?
+        aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment) : malloc(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t size) { return counted_new(size); }
+void* operator new[](size_t size) { return counted_new(size); }
+void* operator new(size_t size, std::align_val_t align) { return counted_new(size, (size_t)align); }
+void* operator new[](size_t size, std::align_val_t align) { return counted_new(size, (size_t)align); }
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+
+// SQLite's default allocator, wrapped by count_sqlite_allocations()
+static sqlite3_mem_methods sqlite_malloc;
+
+static void count_sqlite_allocations() {
+    /** Must run before SQLite is initialized */
+    static sqlite3_mem_methods counted;
+    sqlite3_config(SQLITE_CONFIG_GETMALLOC, &sqlite_malloc);
+    counted = sqlite_malloc;
+    counted.xMalloc = [](int size) { allocations++; return sqlite_malloc.xMalloc(size); };
+    counted.xRealloc = [](void* ptr, int size) {
+        allocations++;
+        return sqlite_malloc.xRealloc(ptr, size);
+    };
+    sqlite3_config(SQLITE_CONFIG_MALLOC, &counted);
+}
+
+namespace {
+    struct Result {
+        double ns_per_op;
+        double allocs_per_op;
+    };
+
+    /** Time ops calls of op, after one untimed warm up call */
+    Result measure(size_t ops, const std::function<void(size_t)>& op) {
+        op(0);
+
+        size_t start_allocs = allocations;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < ops; i++)
+            op(i);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        Result result;
+        result.ns_per_op = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+        result.allocs_per_op = (double)(allocations - start_allocs) / ops;
+        return result;
+    }
+
+    /** A benchmark and the raw C API code it should be compared to */
+    struct Benchmark {
+        std::string name;
+        size_t ops;                          /**< Operations per iteration */
+        std::function<void(SQLite::Conn&)> setup;
+        std::function<void(SQLite::Conn&, size_t)> wrapper;
+        std::function<void(sqlite3*, size_t)> baseline;
+    };
+
+    void report(const Benchmark& bench, const Result& wrapper, const Result& baseline) {
+        printf("%-28s %12.1f %12.2f %12.1f %12.2f %8.2fx\n", bench.name.c_str(),
+            wrapper.ns_per_op, wrapper.allocs_per_op,
+            baseline.ns_per_op, baseline.allocs_per_op,
+            wrapper.ns_per_op / baseline.ns_per_op);
+    }
+
+    void exec(sqlite3* db, const char* sql) {
+        if (sqlite3_exec(db, sql, 0, 0, 0) != SQLITE_OK) {
+            fprintf(stderr, "%s: %s\n", sql, sqlite3_errmsg(db));
+            exit(1);
+        }
+    }
+
+    sqlite3_stmt* prepare(sqlite3* db, const char* sql) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+            fprintf(stderr, "%s: %s\n", sql, sqlite3_errmsg(db));
+            exit(1);
+        }
+
+        return stmt;
+    }
+
+    const char* CREATE_TABLE =
+        "CREATE TABLE players (id INTEGER PRIMARY KEY, name TEXT, touchdowns int, rating real)";
+    const char* INSERT = "INSERT INTO players (name, touchdowns, rating) VALUES (?,?,?)";
+    const size_t TABLE_ROWS = 10000;
+
+    void fill_table(SQLite::Conn& db) {
+        db.exec(CREATE_TABLE);
+        auto loader = db.bulk_insert<std::string, long long int, double>(
+            "players", { "name", "touchdowns", "rating" });
+        for (size_t i = 0; i < TABLE_ROWS; i++)
+            loader.insert("Player number " + std::to_string(i), i % 50, i / 7.0);
+        loader.commit();
+    }
+
+    std::vector<Benchmark> benchmarks() {
+        std::vector<Benchmark> ret;
+
+        ret.push_back({ "prepare (cached)", 1, fill_table,
+            [](SQLite::Conn& db, size_t) {
+                auto results = db.query("SELECT name FROM players WHERE id = ?");
+            },
+            [](sqlite3* db, size_t) {
+                sqlite3_finalize(prepare(db, "SELECT name FROM players WHERE id = ?"));
+            }
+        });
+
+        ret.push_back({ "prepare (uncached)", 1,
+            [](SQLite::Conn& db) {
+                fill_table(db);
+                db.set_cache_capacity(0);
+            },
+            [](SQLite::Conn& db, size_t) {
+                auto results = db.query("SELECT name FROM players WHERE id = ?");
+            },
+            [](sqlite3* db, size_t) {
+                sqlite3_finalize(prepare(db, "SELECT name FROM players WHERE id = ?"));
+            }
+        });
+
+        ret.push_back({ "point lookup", 1, fill_table,
+            [](SQLite::Conn& db, size_t i) {
+                auto results = db.query("SELECT name FROM players WHERE id = ?");
+                results.bind(0, (long long int)(i % TABLE_ROWS + 1));
+                SQLite::RowView row;
+                results.next(row);
+            },
+            [](sqlite3* db, size_t i) {
+                // Prepared once, like the wrapper's statement cache
+                static sqlite3* prepared_for = nullptr;
+                static sqlite3_stmt* stmt = nullptr;
+                if (prepared_for != db) {
+                    stmt = prepare(db, "SELECT name FROM players WHERE id = ?");
+                    prepared_for = db;
+                }
+
+                sqlite3_bind_int64(stmt, 1, (sqlite3_int64)(i % TABLE_ROWS + 1));
+                sqlite3_step(stmt);
+                sqlite3_column_text(stmt, 0);
+                sqlite3_reset(stmt);
+            }
+        });
+
+        ret.push_back({ "bind() 3 values + step", 1000,
+            [](SQLite::Conn& db) { db.exec(CREATE_TABLE); },
+            [](SQLite::Conn& db, size_t) {
+                std::string name = "Tom Brady";
+                auto txn = db.transaction();
+                auto stmt = db.prepare(INSERT);
+                for (size_t i = 0; i < 1000; i++)
+                    stmt.bind(name, (long long int)i, 102.8);
+                txn.commit();
+            },
+            [](sqlite3* db, size_t) {
+                std::string name = "Tom Brady";
+                exec(db, "BEGIN TRANSACTION");
+                sqlite3_stmt* stmt = prepare(db, INSERT);
+                for (size_t i = 0; i < 1000; i++) {
+                    sqlite3_bind_text(stmt, 1, name.c_str(), (int)name.size(), SQLITE_TRANSIENT);
+                    sqlite3_bind_int64(stmt, 2, i);
+                    sqlite3_bind_double(stmt, 3, 102.8);
+                    sqlite3_step(stmt);
+                    sqlite3_reset(stmt);
+                }
+                sqlite3_finalize(stmt);
+                exec(db, "COMMIT");
+            }
+        });
+
+        ret.push_back({ "bind() borrowed text + step", 1000,
+            [](SQLite::Conn& db) { db.exec(CREATE_TABLE); },
+            [](SQLite::Conn& db, size_t) {
+                std::string name(200, 'x');
+                auto txn = db.transaction();
+                auto stmt = db.prepare(INSERT);
+                for (size_t i = 0; i < 1000; i++)
+                    stmt.bind(std::string_view(name), (long long int)i, 102.8);
+                txn.commit();
+            },
+            [](sqlite3* db, size_t) {
+                std::string name(200, 'x');
+                exec(db, "BEGIN TRANSACTION");
+                sqlite3_stmt* stmt = prepare(db, INSERT);
+                for (size_t i = 0; i < 1000; i++) {
+                    sqlite3_bind_text(stmt, 1, name.c_str(), (int)name.size(), SQLITE_STATIC);
+                    sqlite3_bind_int64(stmt, 2, i);
+                    sqlite3_bind_double(stmt, 3, 102.8);
+                    sqlite3_step(stmt);
+                    sqlite3_reset(stmt);
+                }
+                sqlite3_finalize(stmt);
+                exec(db, "COMMIT");
+            }
+        });
+
+        auto raw_scan = [](sqlite3* db, size_t) {
+            sqlite3_stmt* stmt = prepare(db, "SELECT * FROM players");
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                sqlite3_column_int64(stmt, 0);
+                sqlite3_column_text(stmt, 1);
+                sqlite3_column_int64(stmt, 2);
+                sqlite3_column_double(stmt, 3);
+            }
+            sqlite3_finalize(stmt);
+        };
+
+        ret.push_back({ "scan next(vector<string>)", TABLE_ROWS, fill_table,
+            [](SQLite::Conn& db, size_t) {
+                auto results = db.query("SELECT * FROM players");
+                std::vector<std::string> row;
+                while (results.next(row));
+            },
+            raw_scan
+        });
+
+        ret.push_back({ "scan next(vector<SQLField>)", TABLE_ROWS, fill_table,
+            [](SQLite::Conn& db, size_t) {
+                auto results = db.query("SELECT * FROM players");
+                std::vector<SQLite::SQLField> row;
+                while (results.next(row));
+            },
+            raw_scan
+        });
+
+        ret.push_back({ "scan next(RowView)", TABLE_ROWS, fill_table,
+            [](SQLite::Conn& db, size_t) {
+                auto results = db.query("SELECT * FROM players");
+                SQLite::RowView row;
+                while (results.next(row)) {
+                    row[0].get<long long int>();
+                    row[1].get<std::string_view>();
+                    row[2].get<long long int>();
+                    row[3].get<double>();
+                }
+            },
+            raw_scan
+        });
+
+        ret.push_back({ "scan next_batch(1024)", TABLE_ROWS, fill_table,
+            [](SQLite::Conn& db, size_t) {
+                static SQLite::ColumnBatch batch;
+                auto results = db.query("SELECT * FROM players");
+                while (results.next_batch(batch, 1024));
+            },
+            raw_scan
+        });
+
+        ret.push_back({ "scalar function per row", TABLE_ROWS,
+            [](SQLite::Conn& db) {
+                fill_table(db);
+                db.create_function("label", [](std::string_view name, long long int touchdowns) {
+                    return (long long int)name.size() + touchdowns;
+                }, true);
+                sqlite3_create_function_v2(db.get_ptr(), "raw_label", 2,
+                    SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr,
+                    [](sqlite3_context* context, int, sqlite3_value** argv) {
+                        sqlite3_value_text(argv[0]);
+                        sqlite3_result_int64(context, sqlite3_value_bytes(argv[0]) +
+                            sqlite3_value_int64(argv[1]));
+                    }, nullptr, nullptr, nullptr);
+            },
+            [](SQLite::Conn& db, size_t) {
+                auto results = db.query("SELECT sum(label(name, touchdowns)) FROM players");
+                SQLite::RowView row;
+                results.next(row);
+            },
+            [](sqlite3* db, size_t) {
+                sqlite3_stmt* stmt = prepare(db, "SELECT sum(raw_label(name, touchdowns)) FROM players");
+                sqlite3_step(stmt);
+                sqlite3_finalize(stmt);
+            }
+        });
+
+        ret.push_back({ "aggregate per row", TABLE_ROWS,
+            [](SQLite::Conn& db) {
+                struct Mean {
+                    double sum = 0;
+                    long long int count = 0;
+                    void step(double x) { sum += x; count++; }
+                    double result() { return count ? sum / count : 0; }
+                };
+
+                fill_table(db);
+                db.create_aggregate<Mean>("mean");
+                sqlite3_create_function_v2(db.get_ptr(), "raw_mean", 1, SQLITE_UTF8, nullptr,
+                    nullptr,
+                    [](sqlite3_context* context, int, sqlite3_value** argv) {
+                        double* state = (double*)sqlite3_aggregate_context(context, 2 * sizeof(double));
+                        state[0] += sqlite3_value_double(argv[0]);
+                        state[1]++;
+                    },
+                    [](sqlite3_context* context) {
+                        double* state = (double*)sqlite3_aggregate_context(context, 0);
+                        sqlite3_result_double(context, state ? state[0] / state[1] : 0);
+                    }, nullptr);
+            },
+            [](SQLite::Conn& db, size_t) {
+                auto results = db.query("SELECT mean(rating) FROM players GROUP BY touchdowns");
+                SQLite::RowView row;
+                while (results.next(row));
+            },
+            [](sqlite3* db, size_t) {
+                sqlite3_stmt* stmt = prepare(db, "SELECT raw_mean(rating) FROM players GROUP BY touchdowns");
+                while (sqlite3_step(stmt) == SQLITE_ROW);
+                sqlite3_finalize(stmt);
+            }
+        });
+
+        // Baseline joins against a copy of the vector in an indexed table,
+        // not counting the time spent copying it
+        ret.push_back({ "join vector vs temp table", TABLE_ROWS,
+            [](SQLite::Conn& db) {
+                struct Team {
+                    long long int id;
+                    std::string name;
+                };
+
+                static std::vector<Team> teams;
+                if (teams.empty()) {
+                    for (size_t i = 0; i < TABLE_ROWS; i++)
+                        teams.push_back({ (long long int)i + 1, "Team " + std::to_string(i % 32) });
+                }
+
+                fill_table(db);
+                SQLite::VirtualTableSpec<Team> spec;
+                spec.key("id", &Team::id).column("name", &Team::name);
+                SQLite::create_virtual_table(db, "teams", teams, spec);
+                db.exec("CREATE TEMP TABLE teams_copy (id INTEGER PRIMARY KEY, name TEXT)");
+                db.exec("INSERT INTO teams_copy SELECT id, name FROM teams");
+            },
+            [](SQLite::Conn& db, size_t) {
+                auto results = db.query("SELECT players.name, teams.name FROM players "
+                    "JOIN teams ON teams.id = players.id");
+                SQLite::RowView row;
+                while (results.next(row));
+            },
+            [](sqlite3* db, size_t) {
+                sqlite3_stmt* stmt = prepare(db, "SELECT players.name, teams_copy.name FROM players "
+                    "JOIN teams_copy ON teams_copy.id = players.id");
+                while (sqlite3_step(stmt) == SQLITE_ROW);
+                sqlite3_finalize(stmt);
+            }
+        });
+
+        ret.push_back({ "transaction commit", 1,
+            [](SQLite::Conn& db) { db.exec(CREATE_TABLE); },
+            [](SQLite::Conn& db, size_t) {
+                db.transaction().commit();
+            },
+            [](sqlite3* db, size_t) {
+                exec(db, "BEGIN TRANSACTION");
+                exec(db, "COMMIT");
+            }
+        });
+
+        ret.push_back({ "savepoint release", 100,
+            [](SQLite::Conn& db) { db.exec(CREATE_TABLE); },
+            [](SQLite::Conn& db, size_t) {
+                auto txn = db.transaction();
+                for (size_t i = 0; i < 100; i++)
+                    SQLite::Transaction(db).commit();
+                txn.commit();
+            },
+            [](sqlite3* db, size_t) {
+                exec(db, "BEGIN TRANSACTION");
+                for (size_t i = 0; i < 100; i++) {
+                    exec(db, "SAVEPOINT sqlite_cpp_1");
+                    exec(db, "RELEASE sqlite_cpp_1");
+                }
+                exec(db, "COMMIT");
+            }
+        });
+
+        return ret;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 200;
+    std::string filter = (argc > 2) ? argv[2] : "";
+    if (!iterations) iterations = 1;
+    count_sqlite_allocations();
+
+    printf("%-28s %12s %12s %12s %12s %9s\n", "benchmark (per op)", "ns", "allocs",
+        "raw ns", "raw allocs", "vs raw");
+
+    for (auto& bench : benchmarks()) {
+        if (bench.name.find(filter) == std::string::npos) continue;
+
+        Result wrapper, baseline;
+        {
+            SQLite::Conn db(":memory:");
+            bench.setup(db);
+            wrapper = measure(iterations, [&](size_t i) { bench.wrapper(db, i); });
+        }
+
+        {
+            SQLite::Conn db(":memory:");
+            bench.setup(db);
+            sqlite3* raw = db.get_ptr();
+            baseline = measure(iterations, [&](size_t i) { bench.baseline(raw, i); });
+        }
+
+        wrapper.ns_per_op /= bench.ops;
+        wrapper.allocs_per_op /= bench.ops;
+        baseline.ns_per_op /= bench.ops;
+        baseline.allocs_per_op /= bench.ops;
+        report(bench, wrapper, baseline);
+    }
+
+    return 0;
+}
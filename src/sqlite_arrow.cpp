@@ -0,0 +1,185 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+#include "sqlite_arrow.h"
+
+namespace SQLite {
+    namespace {
+        /** Owns the buffers behind one exported ArrowArray */
+        struct ArrayData {
+            Column column;
+            std::vector<const void*> buffers;
+            std::vector<ArrowArray*> children;
+        };
+
+        /** Owns the strings behind one exported ArrowSchema */
+        struct SchemaData {
+            std::string format;
+            std::string name;
+            std::vector<ArrowSchema*> children;
+        };
+
+        void release_array(ArrowArray* array) {
+            auto data = (ArrayData*)array->private_data;
+            for (auto child : data->children) {
+                // Consumers may have moved a child out and marked it released
+                if (child->release) child->release(child);
+                delete child;
+            }
+
+            delete data;
+            array->release = nullptr;
+        }
+
+        void release_schema(ArrowSchema* schema) {
+            auto data = (SchemaData*)schema->private_data;
+            for (auto child : data->children) {
+                if (child->release) child->release(child);
+                delete child;
+            }
+
+            delete data;
+            schema->release = nullptr;
+        }
+
+        const char* arrow_format(int type) {
+            switch (type) {
+            case SQLITE_INTEGER:
+                return "l"; // int64
+            case SQLITE_FLOAT:
+                return "g"; // float64
+            case SQLITE_TEXT:
+                return "U"; // large utf8, 64-bit offsets
+            case SQLITE_BLOB:
+                return "Z"; // large binary, 64-bit offsets
+            default:
+                return "n"; // null
+            }
+        }
+
+        void init_array(ArrowArray* array, ArrayData* data, int64_t length, int64_t null_count) {
+            array->length = length;
+            array->null_count = null_count;
+            array->offset = 0;
+            array->n_buffers = (int64_t)data->buffers.size();
+            array->n_children = (int64_t)data->children.size();
+            array->buffers = data->buffers.data();
+            array->children = data->children.data();
+            array->dictionary = nullptr;
+            array->release = &release_array;
+            array->private_data = data;
+        }
+
+        void init_schema(ArrowSchema* schema, SchemaData* data, int64_t flags) {
+            schema->format = data->format.c_str();
+            schema->name = data->name.c_str();
+            schema->metadata = nullptr;
+            schema->flags = flags;
+            schema->n_children = (int64_t)data->children.size();
+            schema->children = data->children.data();
+            schema->dictionary = nullptr;
+            schema->release = &release_schema;
+            schema->private_data = data;
+        }
+
+        void export_column(Column& column, size_t rows, const std::string& name,
+            ArrowArray* array, ArrowSchema* schema) {
+            /** Move one column's buffers into a child array */
+            std::unique_ptr<SchemaData> schema_data(new SchemaData());
+            schema_data->format = arrow_format(column.type);
+            schema_data->name = name;
+
+            std::unique_ptr<ArrayData> array_data(new ArrayData());
+            array_data->column = std::move(column);
+            Column& col = array_data->column;
+            auto& buffers = array_data->buffers;
+
+            int64_t null_count = (int64_t)col.null_count;
+            if (col.type == SQLITE_NULL) {
+                null_count = (int64_t)rows; // The null type has no buffers
+            }
+            else {
+                buffers.push_back(col.null_count ? col.validity.data() : nullptr);
+                switch (col.type) {
+                case SQLITE_INTEGER:
+                    buffers.push_back(col.ints.data());
+                    break;
+                case SQLITE_FLOAT:
+                    buffers.push_back(col.reals.data());
+                    break;
+                default:
+                    buffers.push_back(col.offsets.data());
+                    buffers.push_back(col.bytes.data());
+                    break;
+                }
+            }
+
+            init_schema(schema, schema_data.release(), ARROW_FLAG_NULLABLE);
+            init_array(array, array_data.release(), (int64_t)rows, null_count);
+        }
+    }
+
+    void export_arrow(ColumnBatch& batch, ArrowArray* out_array, ArrowSchema* out_schema) {
+        /** Export a batch from ResultSet::next_batch() as an Arrow struct
+         *  array with one child per column
+         *
+         *  The batch's buffers are moved into the exported array rather than
+         *  copied, which consumes the batch: it is left empty, and the next
+         *  call to next_batch() allocates its buffers from scratch. Both
+         *  out_array and out_schema must be released by the consumer
+         *  through their release callbacks.
+         *
+         *  **Example**
+         *  ```
+         *  auto results = db.query("SELECT * FROM dillydilly");
+         *  SQLite::ColumnBatch batch;
+         *  ArrowArray array;
+         *  ArrowSchema schema;
+         *
+         *  while (results.next_batch(batch, 65536)) {
+         *      SQLite::export_arrow(batch, &array, &schema);
+         *      consume(&array, &schema); // Calls array.release(), schema.release()
+         *  }
+         *  ```
+         */
+        std::unique_ptr<ArrayData> array_data(new ArrayData());
+        std::unique_ptr<SchemaData> schema_data(new SchemaData());
+        schema_data->format = "+s";
+
+        // Hand children to the parents as soon as they exist, so a failure
+        // part way through is cleaned up by releasing the parents
+        ArrowArray parent_array;
+        ArrowSchema parent_schema;
+        init_array(&parent_array, array_data.release(), (int64_t)batch.rows, 0);
+        init_schema(&parent_schema, schema_data.release(), 0);
+        auto parent_array_data = (ArrayData*)parent_array.private_data;
+        auto parent_schema_data = (SchemaData*)parent_schema.private_data;
+
+        try {
+            parent_array_data->buffers.push_back(nullptr); // Struct validity
+            for (size_t i = 0; i < batch.columns.size(); i++) {
+                parent_array_data->children.push_back(new ArrowArray());
+                parent_array_data->children.back()->release = nullptr;
+                parent_schema_data->children.push_back(new ArrowSchema());
+                parent_schema_data->children.back()->release = nullptr;
+
+                export_column(batch.columns[i], batch.rows, batch.names[i],
+                    parent_array_data->children.back(), parent_schema_data->children.back());
+            }
+        }
+        catch (...) {
+            release_array(&parent_array);
+            release_schema(&parent_schema);
+            throw;
+        }
+
+        // Point at the filled in vectors
+        init_array(&parent_array, parent_array_data, (int64_t)batch.rows, 0);
+        init_schema(&parent_schema, parent_schema_data, 0);
+        *out_array = parent_array;
+        *out_schema = parent_schema;
+        batch.rows = 0;
+    }
+}
@@ -0,0 +1,61 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+/** @file
+ *  Export query results through the Apache Arrow C data interface
+ *  (https://arrow.apache.org/docs/format/CDataInterface.html)
+ */
+
+#pragma once
+#include <stdint.h>
+#include "sqlite_cpp.h"
+
+extern "C" {
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+    struct ArrowSchema {
+        // Array type description
+        const char* format;
+        const char* name;
+        const char* metadata;
+        int64_t flags;
+        int64_t n_children;
+        struct ArrowSchema** children;
+        struct ArrowSchema* dictionary;
+
+        // Release callback
+        void (*release)(struct ArrowSchema*);
+        // Opaque producer-specific data
+        void* private_data;
+    };
+
+    struct ArrowArray {
+        // Array data description
+        int64_t length;
+        int64_t null_count;
+        int64_t offset;
+        int64_t n_buffers;
+        int64_t n_children;
+        const void** buffers;
+        struct ArrowArray** children;
+        struct ArrowArray* dictionary;
+
+        // Release callback
+        void (*release)(struct ArrowArray*);
+        // Opaque producer-specific data
+        void* private_data;
+    };
+
+#endif  // ARROW_C_DATA_INTERFACE
+}
+
+namespace SQLite {
+    void export_arrow(ColumnBatch& batch, ArrowArray* out_array, ArrowSchema* out_schema);
+}
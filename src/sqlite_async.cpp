@@ -0,0 +1,195 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+#include "sqlite_async.h"
+
+namespace SQLite {
+    AsyncConn::AsyncConn(const std::string& db_name) : conn(db_name),
+        head(nullptr), sleeping(false), stopping(false), closed(false), submitted(0),
+        completed(0), failed(0), max_depth(0), total_queue_time(0),
+        total_latency(0), max_latency(0) {
+        /** Open a connection and start its worker thread
+         *  @param[in] db_name Path to SQLite3 database
+         */
+        this->worker = std::thread(&AsyncConn::work, this);
+    }
+
+    AsyncConn::~AsyncConn() {
+        this->close();
+    }
+
+    std::future<void> AsyncConn::exec(const std::string& query) {
+        /** Execute a query that doesn't return anything */
+        return this->submit([query](Conn& conn) { conn.exec(query); });
+    }
+
+    std::future<QueryResult> AsyncConn::query(const std::string& stmt) {
+        /** Run a query and collect all of its rows */
+        return this->submit([stmt](Conn& conn) {
+            QueryResult result;
+            auto results = conn.query(stmt);
+            result.col_names = results.get_col_names();
+
+            std::vector<SQLField> row;
+            while (results.next(row))
+                result.rows.push_back(row);
+
+            return result;
+        });
+    }
+
+    void AsyncConn::close() noexcept {
+        /** Finish every request already submitted, then stop the worker and
+         *  close the connection. Submitting requests afterwards throws
+         *  DatabaseClosed. Calling close() more than once is harmless.
+         *
+         *  When called from a request running on the worker thread, this
+         *  only stops new requests from being accepted, as the worker can't
+         *  join itself. The worker exits once the queue is empty, and the
+         *  connection is closed by the next call to close() from another
+         *  thread, or by the destructor.
+         */
+        this->stopping = true;
+        {
+            std::lock_guard<std::mutex> lock(this->wake_mutex);
+            this->wake.notify_one();
+        }
+
+        if (std::this_thread::get_id() == this->worker.get_id()) return;
+        if (this->closed.exchange(true)) return;
+
+        this->worker.join();
+
+        // Run anything pushed while the worker was stopping
+        while (this->completed < this->submitted) {
+            this->run_all(this->pop_all());
+            std::this_thread::yield();
+        }
+
+        this->conn.close();
+    }
+
+    AsyncConn::Stats AsyncConn::get_stats() const {
+        /** Return a snapshot of the queue's counters. May be called from
+         *  any thread.
+         */
+        Stats stats;
+        stats.completed = this->completed;
+        stats.submitted = this->submitted;
+        stats.failed = this->failed;
+        stats.queue_depth = stats.submitted - stats.completed;
+        stats.max_queue_depth = this->max_depth;
+        stats.total_queue_time = std::chrono::nanoseconds(this->total_queue_time);
+        stats.total_latency = std::chrono::nanoseconds(this->total_latency);
+        stats.max_latency = std::chrono::nanoseconds(this->max_latency);
+
+        std::lock_guard<std::mutex> lock(this->latency_mutex);
+        stats.latency_ns = this->latency_ns;
+        return stats;
+    }
+
+    void AsyncConn::push(Task* task) {
+        /** Add a task to the queue with a compare-and-swap, waking the
+         *  worker if it is asleep
+         */
+        std::unique_ptr<Task> owner(task);
+
+        // Counted before checking stopping, so close() waits for this task
+        size_t depth = ++this->submitted - this->completed;
+        if (this->stopping) {
+            this->submitted--;
+            throw DatabaseClosed();
+        }
+
+        task->submitted = std::chrono::steady_clock::now();
+        size_t max_depth = this->max_depth;
+        while (depth > max_depth && !this->max_depth.compare_exchange_weak(max_depth, depth));
+
+        task->next = this->head.load(std::memory_order_relaxed);
+        while (!this->head.compare_exchange_weak(task->next, task));
+        owner.release();
+
+        if (this->sleeping) {
+            std::lock_guard<std::mutex> lock(this->wake_mutex);
+            this->wake.notify_one();
+        }
+    }
+
+    AsyncConn::Task* AsyncConn::pop_all() noexcept {
+        /** Take every queued task at once, returning them oldest first */
+        Task* task = this->head.exchange(nullptr);
+        Task* ordered = nullptr;
+        while (task) {
+            Task* next = task->next;
+            task->next = ordered;
+            ordered = task;
+            task = next;
+        }
+
+        return ordered;
+    }
+
+    void AsyncConn::work() noexcept {
+        /** Worker thread: run tasks until close() is called and the queue
+         *  is empty
+         */
+        while (true) {
+            Task* task = this->pop_all();
+            if (!task) {
+                if (this->stopping) return;
+
+                // Set sleeping before checking the queue, so a push() either
+                // sees the flag or is seen by the check
+                this->sleeping = true;
+                {
+                    std::unique_lock<std::mutex> lock(this->wake_mutex);
+                    this->wake.wait(lock, [this]() {
+                        return this->head.load() || this->stopping;
+                    });
+                }
+
+                this->sleeping = false;
+                continue;
+            }
+
+            this->run_all(task);
+        }
+    }
+
+    void AsyncConn::run_all(Task* task) noexcept {
+        /** Run and free a list of tasks */
+        while (task) {
+            auto started = std::chrono::steady_clock::now();
+            bool ok = task->run(this->conn);
+            this->record(*task, started, ok);
+
+            Task* next = task->next;
+            delete task;
+            task = next;
+        }
+    }
+
+    void AsyncConn::record(const Task& task, std::chrono::steady_clock::time_point started, bool ok) {
+        /** Update latency counters after running a task */
+        using std::chrono::duration_cast;
+        using std::chrono::nanoseconds;
+
+        auto queue_time = duration_cast<nanoseconds>(started - task.submitted).count();
+        auto latency = duration_cast<nanoseconds>(
+            std::chrono::steady_clock::now() - task.submitted).count();
+
+        this->total_queue_time += queue_time;
+        this->total_latency += latency;
+        if (latency > this->max_latency)
+            this->max_latency.store(latency, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(this->latency_mutex);
+            this->latency_ns.record((uint64_t)latency);
+        }
+
+        if (!ok) this->failed++;
+        this->completed++;
+    }
+}
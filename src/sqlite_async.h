@@ -0,0 +1,207 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+/** @file
+ *  A connection which runs queries on its own thread
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include "sqlite_cpp.h"
+#include "sqlite_profile.h"
+
+namespace SQLite {
+    /** Every row of a query, copied out of SQLite so it can be handed to
+     *  another thread
+     */
+    struct QueryResult {
+        std::vector<std::string> col_names;
+        std::vector<std::vector<SQLField>> rows;
+    };
+
+    /** A connection owned by a dedicated worker thread, so that callers
+     *  such as event loops never block on the database
+     *
+     *  Requests are pushed onto a lock-free queue and executed in order.
+     *  Each one returns a std::future, or calls a completion callback on
+     *  the worker thread. Any number of requests may be submitted before
+     *  waiting on the first, letting the worker pipeline them back to back.
+     *
+     *  **Example**
+     *  ```
+     *  SQLite::AsyncConn db("database.sqlite");
+     *  db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28, 7)");
+     *  auto results = db.query("SELECT * FROM dillydilly");
+     *
+     *  // ...do other work...
+     *  for (auto& row : results.get().rows) {
+     *      // Do stuff with row
+     *  }
+     *  ```
+     *
+     *  #### Memory Safety
+     *  The Conn passed to submit()'s functions, and anything created from
+     *  it, must not be used outside of those functions. Those functions may
+     *  call close(), but must not destroy the AsyncConn.
+     */
+    class AsyncConn {
+    public:
+        /** Counters describing the request queue */
+        struct Stats {
+            size_t submitted = 0;       /**< Requests accepted */
+            size_t completed = 0;       /**< Requests finished, including failures */
+            size_t failed = 0;          /**< Requests which threw an exception */
+            size_t queue_depth = 0;     /**< Requests submitted but not finished */
+            size_t max_queue_depth = 0; /**< Highest queue_depth seen */
+            std::chrono::nanoseconds total_queue_time =
+                std::chrono::nanoseconds(0); /**< Time requests spent waiting to start */
+            std::chrono::nanoseconds total_latency =
+                std::chrono::nanoseconds(0); /**< Time from submission to completion */
+            std::chrono::nanoseconds max_latency =
+                std::chrono::nanoseconds(0); /**< Slowest single request */
+            Histogram latency_ns;       /**< Time from submission to completion,
+                                         *   per request */
+        };
+
+        AsyncConn(const std::string& db_name);
+        AsyncConn(const AsyncConn&) = delete;
+        AsyncConn& operator=(const AsyncConn&) = delete;
+        ~AsyncConn();
+
+        std::future<void> exec(const std::string& query);
+        std::future<QueryResult> query(const std::string& stmt);
+        void close() noexcept;
+        Stats get_stats() const;
+
+        template<typename F>
+        auto submit(F func) -> std::future<decltype(func(std::declval<Conn&>()))> {
+            /** Run func(Conn&) on the worker thread
+             *
+             *  @returns A future holding func's return value, or the
+             *           exception it threw
+             */
+            using T = decltype(func(std::declval<Conn&>()));
+            std::promise<T> promise;
+            auto future = promise.get_future();
+            this->push(new FutureTask<F, T>(std::move(func), std::move(promise)));
+            return future;
+        }
+
+        template<typename F, typename Callback>
+        void submit(F func, Callback callback) {
+            /** Run func(Conn&) on the worker thread, then call
+             *  callback(std::future<T>&&) with its result, also on the
+             *  worker thread
+             *
+             *  The callback must not block, or it will hold up every
+             *  request behind it.
+             */
+            using T = decltype(func(std::declval<Conn&>()));
+            this->push(new CallbackTask<F, T, Callback>(std::move(func), std::move(callback)));
+        }
+
+    private:
+        /** One queued request, linked into the submission queue */
+        struct Task {
+            virtual ~Task() {};
+            virtual bool run(Conn& conn) noexcept = 0; /**< Returns false if it threw */
+
+            Task* next = nullptr;
+            std::chrono::steady_clock::time_point submitted;
+        };
+
+        template<typename F, typename T>
+        struct FutureTask : Task {
+            FutureTask(F func, std::promise<T> promise) :
+                func(std::move(func)), promise(std::move(promise)) {};
+
+            bool run(Conn& conn) noexcept override {
+                return fulfill(this->func, conn, this->promise);
+            }
+
+            F func;
+            std::promise<T> promise;
+        };
+
+        template<typename F, typename T, typename Callback>
+        struct CallbackTask : Task {
+            CallbackTask(F func, Callback callback) :
+                func(std::move(func)), callback(std::move(callback)) {};
+
+            bool run(Conn& conn) noexcept override {
+                std::promise<T> promise;
+                bool ok = fulfill(this->func, conn, promise);
+                try {
+                    this->callback(promise.get_future());
+                }
+                catch (...) {
+                    return false;
+                }
+
+                return ok;
+            }
+
+            F func;
+            Callback callback;
+        };
+
+        template<typename F, typename T>
+        static bool fulfill(F& func, Conn& conn, std::promise<T>& promise) noexcept {
+            try {
+                if constexpr (std::is_void<T>::value) {
+                    func(conn);
+                    promise.set_value();
+                }
+                else {
+                    promise.set_value(func(conn));
+                }
+            }
+            catch (...) {
+                promise.set_exception(std::current_exception());
+                return false;
+            }
+
+            return true;
+        }
+
+        void push(Task* task);
+        Task* pop_all() noexcept;
+        void work() noexcept;
+        void run_all(Task* task) noexcept;
+        void record(const Task& task, std::chrono::steady_clock::time_point started, bool ok);
+
+        Conn conn;
+        std::atomic<Task*> head;        /**< Submitted tasks, newest first */
+        std::atomic<bool> sleeping;     /**< Worker is waiting for tasks */
+        std::atomic<bool> stopping;     /**< No more requests are accepted */
+        std::atomic<bool> closed;       /**< The worker has been joined */
+        std::mutex wake_mutex;          /**< Only used to put the worker to sleep */
+        std::condition_variable wake;
+        std::thread worker;
+
+        /** @name Statistics
+         *  Only written by the worker, except the submission counters
+         */
+        ///@{
+        std::atomic<size_t> submitted;
+        std::atomic<size_t> completed;
+        std::atomic<size_t> failed;
+        std::atomic<size_t> max_depth;
+        std::atomic<long long int> total_queue_time; /**< Nanoseconds */
+        std::atomic<long long int> total_latency;    /**< Nanoseconds */
+        std::atomic<long long int> max_latency;      /**< Nanoseconds */
+
+        mutable std::mutex latency_mutex; /**< Guards latency_ns */
+        Histogram latency_ns;
+        ///@}
+    };
+}
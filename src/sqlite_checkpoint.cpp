@@ -0,0 +1,127 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+#include "sqlite_checkpoint.h"
+
+namespace SQLite {
+    CheckpointScheduler::CheckpointScheduler(const std::string& db_name,
+        const CheckpointOptions& options) : conn(db_name), options(options) {
+        /** Open a connection and start checkpointing
+         *  @param[in] db_name Path to a SQLite3 database file, which must
+         *                     already be in WAL mode
+         */
+        sqlite3_busy_timeout(this->conn.get_ptr(), options.busy_timeout);
+
+        // Never checkpoint from this connection except on purpose
+        sqlite3_wal_autocheckpoint(this->conn.get_ptr(), 0);
+
+        // Also makes the connection read the database header, without which
+        // checkpoints do nothing
+        RowView row;
+        auto journal_mode = this->conn.query("PRAGMA journal_mode");
+        journal_mode.next(row);
+        if (row[0].get<std::string_view>() != "wal")
+            throw ValueError("Checkpoints can only be scheduled for databases in WAL mode");
+        journal_mode.close();
+
+        auto page_size = this->conn.query("PRAGMA page_size");
+        page_size.next(row);
+        this->page_size = row[0].get<long long int>();
+        page_size.close();
+
+        this->worker = std::thread(&CheckpointScheduler::work, this);
+    }
+
+    CheckpointScheduler::~CheckpointScheduler() {
+        this->stop();
+    }
+
+    void CheckpointScheduler::checkpoint_now() {
+        /** Run a checkpoint without waiting for the next interval */
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->requested = true;
+        }
+
+        this->wake.notify_one();
+    }
+
+    void CheckpointScheduler::stop() noexcept {
+        /** Stop the worker thread and close the connection. Calling stop()
+         *  more than once is harmless.
+         */
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (this->stopping) return;
+            this->stopping = true;
+        }
+
+        this->wake.notify_one();
+        this->worker.join();
+        this->conn.close();
+    }
+
+    CheckpointScheduler::Stats CheckpointScheduler::get_stats() const {
+        /** Return a snapshot of the counters. May be called from any thread. */
+        std::lock_guard<std::mutex> lock(this->stats_mutex);
+        return this->stats;
+    }
+
+    void CheckpointScheduler::work() noexcept {
+        /** Worker thread: checkpoint every interval until stop() is called */
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->wake.wait_for(lock, this->options.interval,
+                    [this]() { return this->stopping || this->requested; });
+                if (this->stopping) return;
+                this->requested = false;
+            }
+
+            this->checkpoint(SQLITE_CHECKPOINT_PASSIVE);
+
+            bool over_budget;
+            {
+                std::lock_guard<std::mutex> lock(this->stats_mutex);
+                over_budget = this->stats.backlog_bytes > this->options.wal_budget;
+            }
+
+            if (over_budget) {
+                this->checkpoint(this->options.truncate ?
+                    SQLITE_CHECKPOINT_TRUNCATE : SQLITE_CHECKPOINT_RESTART);
+            }
+        }
+    }
+
+    void CheckpointScheduler::checkpoint(int mode) noexcept {
+        /** Run one checkpoint and record how big the WAL is afterwards */
+        int log_frames = 0, checkpointed = 0;
+        auto start = std::chrono::steady_clock::now();
+        int result = sqlite3_wal_checkpoint_v2(this->conn.base->db, "main", mode,
+            &log_frames, &checkpointed);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        std::lock_guard<std::mutex> lock(this->stats_mutex);
+        if (mode == SQLITE_CHECKPOINT_PASSIVE) this->stats.passive++;
+        else this->stats.forced++;
+
+        if (result == SQLITE_BUSY) {
+            this->stats.busy++;
+        }
+        else if (result != SQLITE_OK) {
+            this->stats.failed++;
+            return;
+        }
+
+        // Each frame is a page plus a 24 byte header. Both counts are -1
+        // if the database isn't in WAL mode.
+        long long int frame_size = this->page_size + 24;
+        this->stats.wal_bytes = std::max(log_frames, 0) * frame_size;
+        this->stats.backlog_bytes = std::max(log_frames - checkpointed, 0) * frame_size;
+        this->stats.max_wal_bytes = std::max(this->stats.max_wal_bytes, this->stats.wal_bytes);
+        this->stats.duration_ns.record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+}
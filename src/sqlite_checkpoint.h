@@ -0,0 +1,105 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+/** @file
+ *  Background checkpointing for databases in WAL mode
+ */
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "sqlite_cpp.h"
+#include "sqlite_profile.h"
+
+namespace SQLite {
+    /** Controls when a CheckpointScheduler checkpoints */
+    struct CheckpointOptions {
+        /** How often to run a PASSIVE checkpoint */
+        std::chrono::milliseconds interval = std::chrono::seconds(1);
+
+        /** Bytes of WAL not yet copied into the database which may build
+         *  up before the scheduler escalates to a checkpoint which waits
+         *  for readers
+         */
+        long long int wal_budget = 64LL << 20;
+
+        /** When over budget, use TRUNCATE to also shrink the WAL file back
+         *  to zero bytes, rather than RESTART
+         */
+        bool truncate = true;
+
+        /** Milliseconds a RESTART or TRUNCATE checkpoint waits for readers
+         *  and writers before giving up until the next interval
+         */
+        int busy_timeout = 1000;
+    };
+
+    /** Runs checkpoints on a background thread with its own connection, so
+     *  that the threads committing writes never have to
+     *
+     *  Every interval, a PASSIVE checkpoint copies as much of the WAL into
+     *  the database as it can without waiting on anyone. If readers keep
+     *  the WAL from being fully checkpointed, it grows without limit. Once
+     *  the part left uncopied passes wal_budget, the scheduler escalates to
+     *  a RESTART or TRUNCATE checkpoint, which waits for readers to move on
+     *  so the WAL can be reused from the start.
+     *
+     *  Connections writing to the database should be opened with
+     *  ConnOptions::wal_autocheckpoint set to 0, so that committing never
+     *  runs a checkpoint itself.
+     *
+     *  **Example**
+     *  ```
+     *  auto options = SQLite::ConnOptions::wal_profile();
+     *  options.wal_autocheckpoint = 0;
+     *  SQLite::Conn db("database.sqlite", options);
+     *  SQLite::CheckpointScheduler checkpointer("database.sqlite");
+     *  ```
+     */
+    class CheckpointScheduler {
+    public:
+        /** Counters describing checkpoints run so far */
+        struct Stats {
+            size_t passive = 0;     /**< PASSIVE checkpoints run */
+            size_t forced = 0;      /**< RESTART or TRUNCATE checkpoints run */
+            size_t busy = 0;        /**< Checkpoints kept from finishing by locks */
+            size_t failed = 0;      /**< Checkpoints which returned an error */
+            long long int wal_bytes = 0;     /**< WAL size after the last checkpoint */
+            long long int max_wal_bytes = 0; /**< Largest WAL size seen */
+            long long int backlog_bytes = 0; /**< Bytes of WAL the last checkpoint
+                                              *   couldn't copy into the database */
+            Histogram duration_ns;  /**< Time taken by each checkpoint */
+        };
+
+        CheckpointScheduler(const std::string& db_name,
+            const CheckpointOptions& options = CheckpointOptions());
+        CheckpointScheduler(const CheckpointScheduler&) = delete;
+        CheckpointScheduler& operator=(const CheckpointScheduler&) = delete;
+        ~CheckpointScheduler();
+
+        void checkpoint_now();
+        void stop() noexcept;
+        Stats get_stats() const;
+
+    private:
+        void work() noexcept;
+        void checkpoint(int mode) noexcept;
+
+        Conn conn;
+        CheckpointOptions options;
+        long long int page_size;
+
+        std::mutex mutex;          /**< Guards stopping and requested */
+        std::condition_variable wake;
+        bool stopping = false;
+        bool requested = false;    /**< Set by checkpoint_now() */
+        std::thread worker;
+
+        mutable std::mutex stats_mutex;
+        Stats stats;
+    };
+}
@@ -0,0 +1,176 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+#include "sqlite_coalesce.h"
+
+namespace SQLite {
+    WriteCoalescer::WriteCoalescer(const std::string& db_name,
+        const WriteCoalescerOptions& options) :
+        conn(db_name, options.connection), options(options) {
+        /** Open a connection and start its worker thread
+         *  @param[in] db_name Path to SQLite3 database
+         */
+        if (!this->options.max_batch_size) this->options.max_batch_size = 1;
+        this->batch.reserve(this->options.max_batch_size);
+        this->worker = std::thread(&WriteCoalescer::work, this);
+    }
+
+    WriteCoalescer::~WriteCoalescer() {
+        this->close();
+    }
+
+    void WriteCoalescer::close() noexcept {
+        /** Commit every write already submitted, then stop the worker and
+         *  close the connection. Submitting writes afterwards throws
+         *  DatabaseClosed. Calling close() more than once is harmless.
+         *
+         *  When called from a write running on the worker thread, this
+         *  only stops new writes from being accepted, as the worker can't
+         *  join itself. The worker exits once the queue is empty, and the
+         *  connection is closed by the next call to close() from another
+         *  thread, or by the destructor.
+         */
+        bool on_worker = std::this_thread::get_id() == this->worker.get_id();
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+            if (this->closed) return;
+            if (!on_worker) this->closed = true;
+        }
+
+        this->wake.notify_one();
+        if (on_worker) return;
+
+        this->worker.join();
+        this->conn.close();
+    }
+
+    WriteCoalescer::Stats WriteCoalescer::get_stats() const {
+        /** Return a snapshot of the counters. May be called from any thread. */
+        std::lock_guard<std::mutex> lock(this->stats_mutex);
+        return this->stats;
+    }
+
+    void WriteCoalescer::push(std::unique_ptr<Task> task) {
+        /** Queue a write, waking the worker if it has nothing to do or
+         *  a full batch is ready
+         */
+        task->submitted = std::chrono::steady_clock::now();
+
+        size_t depth;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (this->stopping) throw DatabaseClosed();
+            this->queue.push_back(std::move(task));
+            depth = this->queue.size();
+        }
+
+        if (depth == 1 || depth == this->options.max_batch_size)
+            this->wake.notify_one();
+    }
+
+    bool WriteCoalescer::take_batch() {
+        /** Wait for writes, then move up to max_batch_size of them into
+         *  batch. Returns false once close() has been called and the queue
+         *  is empty.
+         */
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->wake.wait(lock, [this]() { return !this->queue.empty() || this->stopping; });
+        if (this->queue.empty()) return false;
+
+        // Give other writers a chance to join the batch
+        auto deadline = this->queue.front()->submitted + this->options.max_batch_latency;
+        this->wake.wait_until(lock, deadline, [this]() {
+            return this->queue.size() >= this->options.max_batch_size || this->stopping;
+        });
+
+        size_t n = std::min(this->queue.size(), this->options.max_batch_size);
+        for (size_t i = 0; i < n; i++) {
+            this->batch.push_back(std::move(this->queue.front()));
+            this->queue.pop_front();
+        }
+
+        return true;
+    }
+
+    void WriteCoalescer::work() noexcept {
+        /** Worker thread: commit batches until close() is called and the
+         *  queue is empty
+         */
+        while (this->take_batch()) {
+            this->run_batch();
+            this->batch.clear();
+        }
+    }
+
+    void WriteCoalescer::run_batch() noexcept {
+        /** Commit every write in batch, normally in a single transaction */
+        for (size_t begin = 0; begin < this->batch.size(); )
+            begin = this->run_transaction(begin);
+    }
+
+    size_t WriteCoalescer::run_transaction(size_t begin) noexcept {
+        /** Run writes starting from batch[begin] in one transaction, and
+         *  fulfill their futures once it is committed
+         *
+         *  @returns The index of the first write not handled, which is
+         *           less than batch.size() if SQLite had to abandon the
+         *           transaction part way through
+         */
+        size_t end = begin;
+        try {
+            Transaction txn(this->conn, TransactionMode::IMMEDIATE);
+            while (end < this->batch.size()) {
+                Transaction savepoint(this->conn);
+                if (this->batch[end++]->run(this->conn)) {
+                    savepoint.commit();
+                    continue;
+                }
+
+                if (sqlite3_get_autocommit(this->conn.get_ptr())) {
+                    // Some errors, such as SQLITE_FULL, make SQLite roll
+                    // back the whole transaction. The failed write keeps
+                    // its own exception, while the ones before it were lost.
+                    this->finish(begin, end, std::make_exception_ptr(SQLiteError(
+                        "Transaction was rolled back by another write in the same batch")));
+                    return end;
+                }
+            }
+
+            txn.commit();
+        }
+        catch (...) {
+            // Couldn't begin or commit, so none of the writes were saved
+            end = this->batch.size();
+            this->finish(begin, end, std::current_exception());
+            return end;
+        }
+
+        this->finish(begin, end, nullptr);
+        return end;
+    }
+
+    void WriteCoalescer::finish(size_t begin, size_t end, std::exception_ptr error) noexcept {
+        /** Fulfill the futures of batch[begin, end), after recording
+         *  statistics so that they are up to date once the futures are ready
+         */
+        auto now = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(this->stats_mutex);
+            this->stats.writes += end - begin;
+            this->stats.batches++;
+            this->stats.batch_sizes.record(end - begin);
+            for (size_t i = begin; i < end; i++) {
+                auto& task = *this->batch[i];
+                if (error || task.failed()) this->stats.failed++;
+                this->stats.latency_ns.record(std::chrono::duration_cast<
+                    std::chrono::nanoseconds>(now - task.submitted).count());
+            }
+        }
+
+        for (size_t i = begin; i < end; i++)
+            this->batch[i]->finish(error);
+    }
+}
@@ -0,0 +1,190 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+/** @file
+ *  Group commit: many threads' writes sharing one transaction
+ */
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include "sqlite_cpp.h"
+#include "sqlite_profile.h"
+
+namespace SQLite {
+    /** Controls how a WriteCoalescer groups writes into transactions */
+    struct WriteCoalescerOptions {
+        /** Most writes committed by one transaction */
+        size_t max_batch_size = 256;
+
+        /** Longest the oldest queued write waits for others to join its
+         *  batch. Zero only groups writes which queued up while the
+         *  previous batch was being committed.
+         */
+        std::chrono::microseconds max_batch_latency = std::chrono::milliseconds(1);
+
+        /** Settings for the writer's connection. The busy timeout keeps
+         *  other writers from failing a whole batch with SQLITE_BUSY.
+         */
+        ConnOptions connection = ConnOptions::wal_profile();
+    };
+
+    /** Funnels writes from any number of threads through a single
+     *  connection, running each batch of them in one transaction
+     *
+     *  SQLite allows one writer at a time, and every commit waits on the
+     *  disk. Rather than paying for a commit per write, submitted
+     *  functions are queued and run back to back on a worker thread. Each
+     *  one gets its own savepoint, so a write which throws is rolled back
+     *  without affecting the rest of its batch. The batch is then
+     *  committed once, after which every caller's future becomes ready.
+     *
+     *  **Example**
+     *  ```
+     *  SQLite::WriteCoalescer writer("database.sqlite");
+     *
+     *  // From any thread
+     *  auto done = writer.submit([](SQLite::Conn& conn) {
+     *      auto stmt = conn.prepare("INSERT INTO dillydilly VALUES (?,?,?)");
+     *      stmt.bind("Tom Brady", 28, 7);
+     *  });
+     *  done.get(); // Durable once this returns
+     *  ```
+     *
+     *  #### Memory Safety
+     *  The Conn passed to submitted functions, and anything created from
+     *  it, must not be used outside of those functions. Functions must not
+     *  commit or roll back the batch's transaction themselves, although
+     *  they may use nested Transactions.
+     */
+    class WriteCoalescer {
+    public:
+        /** Counters for tuning WriteCoalescerOptions */
+        struct Stats {
+            size_t writes = 0;       /**< Writes finished, including failures */
+            size_t failed = 0;       /**< Writes whose futures hold an exception */
+            size_t batches = 0;      /**< Transactions committed or attempted */
+            Histogram batch_sizes;   /**< Writes per batch */
+            Histogram latency_ns;    /**< Time from submission to completion */
+        };
+
+        WriteCoalescer(const std::string& db_name,
+            const WriteCoalescerOptions& options = WriteCoalescerOptions());
+        WriteCoalescer(const WriteCoalescer&) = delete;
+        WriteCoalescer& operator=(const WriteCoalescer&) = delete;
+        ~WriteCoalescer();
+
+        void close() noexcept;
+        Stats get_stats() const;
+
+        template<typename F>
+        auto submit(F func) -> std::future<decltype(func(std::declval<Conn&>()))> {
+            /** Queue func(Conn&) to run in the next batch
+             *
+             *  @returns A future which becomes ready once the batch
+             *           containing func has been committed, holding func's
+             *           return value. If func throws, or the batch could
+             *           not be committed, the future holds the exception.
+             */
+            using T = decltype(func(std::declval<Conn&>()));
+            std::unique_ptr<WriteTask<F, T>> task(new WriteTask<F, T>(std::move(func)));
+            auto future = task->promise.get_future();
+            this->push(std::move(task));
+            return future;
+        }
+
+    private:
+        /** One queued write */
+        struct Task {
+            virtual ~Task() {};
+
+            /** Run the write, returning false if it threw */
+            virtual bool run(Conn& conn) noexcept = 0;
+
+            /** Fulfill the caller's future once the batch is done
+             *  @param[in] error Set if the batch failed as a whole
+             */
+            virtual void finish(std::exception_ptr error) noexcept = 0;
+
+            bool failed() const { return (bool)this->error; }
+
+            std::exception_ptr error; /**< Thrown by the write */
+            std::chrono::steady_clock::time_point submitted;
+        };
+
+        template<typename F, typename T>
+        struct WriteTask : Task {
+            using Value = typename std::conditional<std::is_void<T>::value, bool, T>::type;
+
+            WriteTask(F func) : func(std::move(func)) {};
+
+            bool run(Conn& conn) noexcept override {
+                try {
+                    if constexpr (std::is_void<T>::value) {
+                        this->func(conn);
+                        this->value.emplace(true);
+                    }
+                    else {
+                        this->value.emplace(this->func(conn));
+                    }
+                }
+                catch (...) {
+                    this->error = std::current_exception();
+                    return false;
+                }
+
+                return true;
+            }
+
+            void finish(std::exception_ptr batch_error) noexcept override {
+                try {
+                    if (this->error || batch_error)
+                        this->promise.set_exception(this->error ? this->error : batch_error);
+                    else if constexpr (std::is_void<T>::value)
+                        this->promise.set_value();
+                    else
+                        this->promise.set_value(std::move(*this->value));
+                }
+                catch (...) {
+                    // The value's move constructor threw
+                    this->promise.set_exception(std::current_exception());
+                }
+            }
+
+            F func;
+            std::promise<T> promise;
+            std::optional<Value> value;
+        };
+
+        void push(std::unique_ptr<Task> task);
+        bool take_batch();
+        void work() noexcept;
+        void run_batch() noexcept;
+        size_t run_transaction(size_t begin) noexcept;
+        void finish(size_t begin, size_t end, std::exception_ptr error) noexcept;
+
+        Conn conn;
+        WriteCoalescerOptions options;
+
+        std::mutex mutex;                       /**< Guards queue, stopping, and closed */
+        std::condition_variable wake;
+        std::deque<std::unique_ptr<Task>> queue;
+        bool stopping = false;                  /**< No more writes are accepted */
+        bool closed = false;                    /**< The worker has been joined */
+
+        std::vector<std::unique_ptr<Task>> batch; /**< Only used by the worker */
+        std::thread worker;
+
+        mutable std::mutex stats_mutex;
+        Stats stats;
+    };
+}
@@ -0,0 +1,318 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+/** @file
+ *  C++20 coroutine support: awaitable queries run by an AsyncConn, and
+ *  generators over query results
+ *
+ *  Everything in this file is only available when compiling with
+ *  coroutine support (e.g. -std=c++20).
+ */
+
+#pragma once
+#include "sqlite_async.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <functional>
+
+namespace SQLite {
+    /** Awaitable returned by co_submit(), which suspends the awaiting
+     *  coroutine until func(Conn&) has run on the AsyncConn's worker
+     *
+     *  The coroutine is resumed on the worker thread. Hand it off to
+     *  another thread before doing anything slow, and never block on
+     *  another request to the same AsyncConn from there.
+     */
+    template<typename F>
+    class SubmitAwaiter {
+    public:
+        using T = decltype(std::declval<F&>()(std::declval<Conn&>()));
+
+        SubmitAwaiter(AsyncConn& db, F func) : db(&db), func(std::move(func)) {};
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            // The awaiter may be destroyed as soon as the coroutine resumes,
+            // so nothing may touch it after submit()
+            this->db->submit(std::move(this->func),
+                [this, handle](std::future<T> result) {
+                    this->result = std::move(result);
+                    handle.resume();
+                });
+        }
+
+        T await_resume() { return this->result.get(); }
+
+    private:
+        AsyncConn* db;
+        F func;
+        std::future<T> result;
+    };
+
+    /** @name Awaitable Requests */
+    ///@{
+    template<typename F>
+    SubmitAwaiter<F> co_submit(AsyncConn& db, F func) {
+        /** Run func(Conn&) on db's worker thread
+         *
+         *  **Example**
+         *  ```
+         *  long long int count = co_await SQLite::co_submit(db, [](SQLite::Conn& conn) {
+         *      auto results = conn.query("SELECT count(*) FROM dillydilly");
+         *      SQLite::RowView row;
+         *      results.next(row);
+         *      return row[0].get<long long int>();
+         *  });
+         *  ```
+         */
+        return SubmitAwaiter<F>(db, std::move(func));
+    }
+
+    inline auto co_exec(AsyncConn& db, std::string query) {
+        /** Execute a query that doesn't return anything */
+        return co_submit(db, [query = std::move(query)](Conn& conn) { conn.exec(query); });
+    }
+
+    inline auto co_query(AsyncConn& db, std::string stmt) {
+        /** Run a query and collect all of its rows
+         *  @see RowStream for results too large to hold at once
+         */
+        return co_submit(db, [stmt = std::move(stmt)](Conn& conn) {
+            QueryResult result;
+            auto results = conn.query(stmt);
+            result.col_names = results.get_col_names();
+
+            std::vector<SQLField> row;
+            while (results.next(row))
+                result.rows.push_back(row);
+
+            return result;
+        });
+    }
+    ///@}
+
+    /** Streams the results of a query from an AsyncConn's worker in
+     *  batches, so large results are never buffered whole and the thread
+     *  handoff is paid once per batch rather than once per row
+     *
+     *  **Example**
+     *  ```
+     *  SQLite::RowStream stream(db, "SELECT * FROM dillydilly");
+     *  while (co_await stream.next()) {
+     *      for (auto& row : stream.batch()) {
+     *          // Do stuff with row
+     *      }
+     *  }
+     *  ```
+     *
+     *  #### Memory Safety
+     *  The stream must not outlive its AsyncConn, and only one next() may
+     *  be awaited at a time.
+     */
+    class RowStream {
+    public:
+        using Row = std::vector<SQLField>;
+        using Batch = std::vector<Row>;
+
+        RowStream(AsyncConn& db, std::string stmt, size_t batch_size = 1024) :
+            db(&db), state(std::make_shared<State>()) {
+            this->state->stmt = std::move(stmt);
+            this->state->batch_size = batch_size ? batch_size : 1;
+        }
+
+        RowStream(const RowStream&) = delete;
+        RowStream& operator=(const RowStream&) = delete;
+
+        ~RowStream() {
+            // The statement belongs to the worker's connection, so it must
+            // also be closed there
+            auto state = std::move(this->state);
+            try {
+                this->db->submit([state](Conn&) { state->results.reset(); });
+            }
+            catch (...) {
+                state->results.reset(); // Worker already stopped
+            }
+        }
+
+        /** Awaitable which fetches the next batch, yielding false once the
+         *  results are exhausted
+         */
+        auto next() {
+            return FetchAwaiter(this);
+        }
+
+        /** The rows fetched by the last next() */
+        const Batch& batch() const { return this->rows; }
+        const std::vector<std::string>& col_names() const { return this->names; }
+
+    private:
+        /** Owned by the worker thread while a fetch is in progress */
+        struct State {
+            using ResultSet = decltype(std::declval<Conn&>().query(std::string()));
+
+            std::string stmt;
+            size_t batch_size;
+            std::optional<ResultSet> results;
+            std::vector<std::string> col_names;
+            Batch rows;       /**< Buffers being filled in */
+            bool done = false;
+        };
+
+        class FetchAwaiter {
+        public:
+            FetchAwaiter(RowStream* stream) : stream(stream) {};
+
+            bool await_ready() const noexcept { return this->stream->state->done; }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                // Let the worker reuse the previous batch's buffers
+                auto state = this->stream->state;
+                state->rows.swap(this->stream->rows);
+                this->waiter.emplace(*this->stream->db,
+                    [state](Conn& conn) { return fetch(*state, conn); });
+                this->waiter->await_suspend(handle);
+            }
+
+            bool await_resume() {
+                if (!this->waiter) { // Already done
+                    this->stream->rows.clear();
+                    return false;
+                }
+
+                bool more = this->waiter->await_resume();
+                auto& state = *this->stream->state;
+                this->stream->rows.swap(state.rows);
+                if (this->stream->names.empty())
+                    this->stream->names = state.col_names;
+                return more;
+            }
+
+        private:
+            using Fetch = std::function<bool(Conn&)>;
+
+            RowStream* stream;
+            std::optional<SubmitAwaiter<Fetch>> waiter;
+        };
+
+        static bool fetch(State& state, Conn& conn) {
+            /** Read up to batch_size rows. Runs on the worker thread. */
+            if (!state.results) {
+                state.results.emplace(conn.query(state.stmt));
+                state.col_names = state.results->get_col_names();
+            }
+
+            size_t n = 0;
+            state.rows.resize(state.batch_size);
+            while (n < state.batch_size && state.results->next(state.rows[n]))
+                n++;
+            state.rows.resize(n);
+
+            if (n < state.batch_size) {
+                state.done = true;
+                state.results.reset();
+            }
+
+            return n > 0;
+        }
+
+        AsyncConn* db;
+        std::shared_ptr<State> state;
+        Batch rows;
+        std::vector<std::string> names;
+    };
+
+    /** A lazily evaluated sequence of values produced by a coroutine with
+     *  co_yield, which can be iterated over with a range-based for loop
+     *
+     *  Each value is only valid until the loop advances.
+     */
+    template<typename T>
+    class Generator {
+    public:
+        struct promise_type {
+            const T* value = nullptr;
+            std::exception_ptr error;
+
+            Generator get_return_object() {
+                return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            std::suspend_always yield_value(const T& val) noexcept {
+                this->value = std::addressof(val);
+                return {};
+            }
+
+            void return_void() noexcept {}
+            void unhandled_exception() { this->error = std::current_exception(); }
+        };
+
+        class iterator {
+        public:
+            iterator(std::coroutine_handle<promise_type> handle) : handle(handle) {};
+
+            const T& operator*() const { return *this->handle.promise().value; }
+            const T* operator->() const { return this->handle.promise().value; }
+            iterator& operator++() {
+                advance(this->handle);
+                return *this;
+            }
+
+            bool operator==(std::default_sentinel_t) const { return this->handle.done(); }
+
+        private:
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        Generator(Generator&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+        Generator& operator=(Generator&& other) noexcept {
+            std::swap(this->handle, other.handle);
+            return *this;
+        }
+
+        ~Generator() {
+            if (this->handle) this->handle.destroy();
+        }
+
+        iterator begin() {
+            advance(this->handle);
+            return iterator(this->handle);
+        }
+
+        std::default_sentinel_t end() const noexcept { return {}; }
+
+    private:
+        explicit Generator(std::coroutine_handle<promise_type> handle) : handle(handle) {};
+
+        static void advance(std::coroutine_handle<promise_type> handle) {
+            handle.resume();
+            if (handle.promise().error)
+                std::rethrow_exception(handle.promise().error);
+        }
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    template<typename Results>
+    Generator<RowView> rows(Results results) {
+        /** Iterate over the rows of a query without copying them
+         *
+         *  **Example**
+         *  ```
+         *  for (auto& row : SQLite::rows(db.query("SELECT * FROM dillydilly"))) {
+         *      // Do stuff with row[0].get<std::string_view>()
+         *  }
+         *  ```
+         */
+        RowView row;
+        while (results.next(row))
+            co_yield row;
+    }
+}
+#endif
@@ -28,6 +28,10 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <ctype.h>
+#include <stdio.h>
+#include <istream>
+#include <ostream>
 #include "sqlite_cpp.h"
 
 namespace SQLite {
@@ -35,21 +39,286 @@ namespace SQLite {
      *  Blah
      */
 
-    void throw_sqlite_error(const int& error_code, const int& ext_error_code) {
+    void throw_sqlite_error(const int& error_code, const int& ext_error_code,
+        const std::string& detail) {
+        /** Throw a SQLiteError describing an error code
+         *  @param[in] detail Appended to the message if not empty,
+         *                    e.g. the result of sqlite3_errmsg()
+         */
         auto error_msg = SQLITE_ERROR_MSG.find(error_code);
         auto ext_error_msg = SQLITE_EXT_ERROR_MSG.find(ext_error_code);
 
+        std::string msg;
         if (error_msg != SQLITE_ERROR_MSG.end()) {
             if (ext_error_msg != SQLITE_EXT_ERROR_MSG.end())
-                throw SQLiteError(ext_error_msg->second);
+                msg = ext_error_msg->second;
             else
-                throw SQLiteError(error_msg->second);
+                msg = error_msg->second;
         }
         else {
-            throw SQLiteError("Code " + std::to_string(error_code));
+            msg = "Code " + std::to_string(error_code);
         }
+
+        if (!detail.empty()) msg += ": " + detail;
+        throw SQLiteError(msg);
     }
     
+    //
+    // StatementCache
+    //
+
+    sqlite3_stmt* StatementCache::take(const std::string& sql, std::string& key) {
+        /** Check out an idle statement matching sql, or return nullptr
+         *  if the caller needs to prepare a new one
+         *
+         *  @param[in]  sql The SQL text of the statement
+         *  @param[out] key Set to the cache key the statement should be
+         *                  returned under
+         */
+        auto it = this->index.find(sql);
+        if (it == this->index.end()) {
+            this->stats.misses++;
+            key = sql;
+            return nullptr;
+        }
+
+        auto entry = it->second;
+        sqlite3_stmt* stmt = entry->second;
+        this->index.erase(it);
+        key = std::move(entry->first); // Reuse the key's buffer
+        this->entries.erase(entry);
+        this->stats.hits++;
+        return stmt;
+    }
+
+    void StatementCache::put(std::string& key, sqlite3_stmt* stmt) noexcept {
+        /** Reset a statement and make it available for reuse, evicting the
+         *  least recently used statement if the cache is full
+         */
+        if (this->capacity == 0 || this->index.count(key)) {
+            // Caching disabled, or an identical statement is already idle
+            sqlite3_finalize(stmt);
+            return;
+        }
+
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+
+        this->entries.emplace_front(std::move(key), stmt);
+        this->index[this->entries.front().first] = this->entries.begin();
+        while (this->entries.size() > this->capacity)
+            this->evict();
+    }
+
+    void StatementCache::evict() noexcept {
+        /** Finalize the least recently used statement */
+        auto& entry = this->entries.back();
+        this->index.erase(entry.first);
+        sqlite3_finalize(entry.second);
+        this->entries.pop_back();
+        this->stats.evictions++;
+    }
+
+    void StatementCache::clear() noexcept {
+        /** Finalize every idle statement */
+        this->index.clear();
+        for (auto& entry : this->entries)
+            sqlite3_finalize(entry.second);
+        this->entries.clear();
+    }
+
+    void StatementCache::set_capacity(size_t new_capacity) noexcept {
+        /** Change the maximum number of idle statements, evicting the
+         *  least recently used ones if there are too many.
+         *  A capacity of zero disables caching.
+         */
+        this->capacity = new_capacity;
+        while (this->entries.size() > this->capacity)
+            this->evict();
+    }
+
+    //
+    // conn_base
+    //
+
+    void conn_base::link(stmt_base* stmt) noexcept {
+        /** Register a statement to be closed along with the connection */
+        stmt->registry = this;
+        stmt->prev = nullptr;
+        stmt->next = this->stmts;
+        if (this->stmts) this->stmts->prev = stmt;
+        this->stmts = stmt;
+        this->stmt_count++;
+    }
+
+    void conn_base::unlink(stmt_base* stmt) noexcept {
+        /** Remove a statement from the registry in constant time */
+        if (stmt->prev) stmt->prev->next = stmt->next;
+        else this->stmts = stmt->next;
+        if (stmt->next) stmt->next->prev = stmt->prev;
+
+        stmt->registry = nullptr;
+        stmt->prev = nullptr;
+        stmt->next = nullptr;
+        this->stmt_count--;
+    }
+
+    void conn_base::close_statements() noexcept {
+        /** Close every statement still in use, each unlinking itself */
+        while (stmts)
+            stmts->close();
+    }
+
+    void conn_base::close() noexcept {
+        if (db) {
+            // Statements still in use are closed first
+            close_statements();
+
+            // Cached statements must be finalized before the handle is closed
+            cache.clear();
+            transactions.clear();
+            // Unlike sqlite3_close(), this succeeds even if BLOB handles
+            // are still open: the handle lingers until they are closed
+            sqlite3_close_v2(db);
+            db = nullptr;
+        }
+    }
+
+    //
+    // TransactionStatements
+    //
+
+    void TransactionStatements::prepare(sqlite3* db, sqlite3_stmt*& stmt, const std::string& sql) {
+        sqlite3_finalize(stmt); // Left over from an earlier failure
+        stmt = nullptr;
+        if (sqlite3_prepare_v3(db, sql.c_str(), (int)sql.size() + 1,
+            SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK)
+            throw SQLiteError(sqlite3_errmsg(db));
+    }
+
+    void TransactionStatements::run(sqlite3* db, sqlite3_stmt*& stmt, const char* sql) {
+        /** Run a statement, preparing it first if this is its first use */
+        if (!stmt) prepare(db, stmt, sql);
+
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::string error = sqlite3_errmsg(db);
+            sqlite3_reset(stmt);
+            throw SQLiteError(error);
+        }
+
+        sqlite3_reset(stmt);
+    }
+
+    TransactionStatements::Savepoint& TransactionStatements::get_savepoint(sqlite3* db, size_t level) {
+        /** Return the statements for a savepoint, preparing them first if
+         *  this nesting level hasn't been reached before
+         */
+        if (level >= this->savepoints.size())
+            this->savepoints.resize(level + 1);
+
+        Savepoint& savepoint = this->savepoints[level];
+        if (!savepoint.savepoint) {
+            std::string name = "sqlite_cpp_" + std::to_string(level);
+            prepare(db, savepoint.release, "RELEASE " + name);
+            prepare(db, savepoint.rollback_to, "ROLLBACK TO " + name);
+            prepare(db, savepoint.savepoint, "SAVEPOINT " + name);
+        }
+
+        return savepoint;
+    }
+
+    void TransactionStatements::begin(sqlite3* db, TransactionMode mode) {
+        static const char* const BEGIN[] = {
+            "BEGIN DEFERRED", "BEGIN IMMEDIATE", "BEGIN EXCLUSIVE" };
+        size_t i = (size_t)mode;
+        run(db, this->begin_stmts[i], BEGIN[i]);
+    }
+
+    void TransactionStatements::commit(sqlite3* db) {
+        run(db, this->commit_stmt, "COMMIT");
+    }
+
+    void TransactionStatements::rollback(sqlite3* db) {
+        run(db, this->rollback_stmt, "ROLLBACK");
+    }
+
+    void TransactionStatements::savepoint(sqlite3* db, size_t level) {
+        run(db, this->get_savepoint(db, level).savepoint, nullptr);
+    }
+
+    void TransactionStatements::release(sqlite3* db, size_t level) {
+        run(db, this->get_savepoint(db, level).release, nullptr);
+    }
+
+    void TransactionStatements::rollback_to(sqlite3* db, size_t level) {
+        /** Undo everything since a savepoint began, then release it */
+        Savepoint& savepoint = this->get_savepoint(db, level);
+        run(db, savepoint.rollback_to, nullptr);
+        run(db, savepoint.release, nullptr);
+    }
+
+    void TransactionStatements::clear() noexcept {
+        /** Finalize every statement. Must be called before the connection
+         *  they were prepared on is closed.
+         */
+        for (auto& stmt : this->begin_stmts) {
+            sqlite3_finalize(stmt);
+            stmt = nullptr;
+        }
+
+        for (auto& savepoint : this->savepoints) {
+            sqlite3_finalize(savepoint.savepoint);
+            sqlite3_finalize(savepoint.release);
+            sqlite3_finalize(savepoint.rollback_to);
+        }
+
+        sqlite3_finalize(this->commit_stmt);
+        sqlite3_finalize(this->rollback_stmt);
+        this->commit_stmt = nullptr;
+        this->rollback_stmt = nullptr;
+        this->savepoints.clear();
+    }
+
+    //
+    // SlowQueryLog
+    //
+
+    void SlowQueryLog::log(sqlite3_stmt* stmt, std::chrono::nanoseconds elapsed) noexcept {
+        /** Build a SlowQuery for stmt and hand it to the sink. Errors are
+         *  swallowed so logging never fails the query being logged.
+         */
+        try {
+            SlowQuery query;
+            query.sql = sqlite3_sql(stmt);
+            query.elapsed = elapsed;
+
+            if (!this->options.redact) {
+                if (char* expanded = sqlite3_expanded_sql(stmt)) {
+                    query.expanded_sql = expanded;
+                    sqlite3_free(expanded);
+                }
+            }
+
+            if (this->options.explain) {
+                std::string explain = "EXPLAIN QUERY PLAN " + query.sql;
+                sqlite3_stmt* plan = nullptr;
+                if (sqlite3_prepare_v2(sqlite3_db_handle(stmt), explain.c_str(),
+                        (int)explain.size(), &plan, nullptr) == SQLITE_OK) {
+                    while (sqlite3_step(plan) == SQLITE_ROW) {
+                        // Column 3 is "detail" in every version of the output
+                        auto detail = (const char *)sqlite3_column_text(plan, 3);
+                        query.plan.push_back(detail ? detail : "");
+                    }
+                }
+
+                sqlite3_finalize(plan);
+            }
+
+            this->sink(query);
+        }
+        catch (...) {}
+    }
+
     Conn::Conn(const char * db_name) {
         /** Open a connection to a SQLite3 database
          *  @param[in] db_name Path to SQLite3 database
@@ -66,6 +335,114 @@ namespace SQLite {
             throw SQLiteError("Failed to open database");
     };
 
+    Conn::Conn(const std::string& db_name, const ConnOptions& options) {
+        /** Open a connection to a SQLite3 database and configure it
+         *  @param[in] db_name Path to SQLite3 database, or a "file:" URI
+         *  @param[in] options Flags and pragmas to set, see
+         *                     ConnOptions::wal_profile() and
+         *                     ConnOptions::snapshot_profile() for good
+         *                     starting points
+         */
+        static const char* const SYNCHRONOUS[] = { "", "OFF", "NORMAL", "FULL", "EXTRA" };
+        static const char* const TEMP_STORE[] = { "", "FILE", "MEMORY" };
+
+        bool read_only = options.read_only || options.immutable;
+        if (read_only && options.wal)
+            throw ValueError("Read-only connections can't switch the database to WAL mode");
+
+        int flags = read_only ? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        if (options.nomutex) flags |= SQLITE_OPEN_NOMUTEX;
+
+        std::string filename = db_name;
+        if (db_name.compare(0, 5, "file:") == 0) {
+            flags |= SQLITE_OPEN_URI;
+            if (options.immutable)
+                filename += (db_name.find('?') == std::string::npos) ? "?immutable=1" : "&immutable=1";
+        }
+        else if (options.immutable) {
+            // Only URIs can carry the immutable parameter
+            flags |= SQLITE_OPEN_URI;
+            filename = "file:";
+            for (char c : db_name) {
+                if (c == '%' || c == '?' || c == '#') {
+                    char escaped[4];
+                    snprintf(escaped, sizeof(escaped), "%%%02X", (unsigned char)c);
+                    filename += escaped;
+                }
+                else {
+                    filename += c;
+                }
+            }
+            filename += "?immutable=1";
+        }
+
+        if (sqlite3_open_v2(filename.c_str(), this->base->get_ref(), flags, nullptr) != SQLITE_OK) {
+            std::string error = this->base->db ? sqlite3_errmsg(this->base->db) : "out of memory";
+            throw SQLiteError("Failed to open database: " + error);
+        }
+
+        // Set before switching to WAL, which has to wait for locks
+        if (options.busy_timeout)
+            sqlite3_busy_timeout(this->get_ptr(), options.busy_timeout);
+        if (options.wal) {
+            // SQLite reports the mode actually in use, rather than failing,
+            // e.g. "memory" for in-memory databases
+            auto journal_mode = this->query("PRAGMA journal_mode=WAL");
+            RowView row;
+            journal_mode.next(row);
+            std::string mode(row[0].get<std::string_view>());
+            journal_mode.close();
+            if (mode != "wal")
+                throw SQLiteError("Could not switch to WAL mode, journal mode is " + mode);
+        }
+        if (options.synchronous != Synchronous::DEFAULT)
+            this->exec(std::string("PRAGMA synchronous=") + SYNCHRONOUS[(int)options.synchronous]);
+        if (options.mmap_size >= 0)
+            this->exec("PRAGMA mmap_size=" + std::to_string(options.mmap_size));
+        if (options.cache_size)
+            this->exec("PRAGMA cache_size=" + std::to_string(options.cache_size));
+        if (options.temp_store != TempStore::DEFAULT)
+            this->exec(std::string("PRAGMA temp_store=") + TEMP_STORE[(int)options.temp_store]);
+        if (options.wal_autocheckpoint >= 0)
+            sqlite3_wal_autocheckpoint(this->get_ptr(), options.wal_autocheckpoint);
+    }
+
+    ConnOptions ConnOptions::wal_profile() {
+        /** Settings suited to most applications which write concurrently
+         *  with reads: WAL mode with synchronous=NORMAL, 256 MiB memory
+         *  mapped, a 64 MiB page cache, in-memory temporary tables, and
+         *  waiting up to 5 seconds for locks
+         */
+        ConnOptions options;
+        options.wal = true;
+        options.synchronous = Synchronous::NORMAL;
+        options.mmap_size = 256LL << 20;
+        options.cache_size = -(64LL << 10);
+        options.temp_store = TempStore::MEMORY;
+        options.busy_timeout = 5000;
+        return options;
+    }
+
+    ConnOptions ConnOptions::snapshot_profile() {
+        /** Settings for databases which are never written to after being
+         *  built, such as reference data shipped with an application:
+         *  opened read-only and immutable, so that readers never take locks
+         *  or touch journal files, with the whole file memory mapped (up to
+         *  SQLite's compile time SQLITE_MAX_MMAP_SIZE) so that processes
+         *  share the OS page cache, and no connection mutex
+         *
+         *  **Note**: If the file does change while open, queries may return
+         *  wrong results or report corruption.
+         */
+        ConnOptions options;
+        options.read_only = true;
+        options.immutable = true;
+        options.nomutex = true;
+        options.mmap_size = 1LL << 40; // Clamped to the file and compile time limit
+        options.temp_store = TempStore::MEMORY;
+        return options;
+    }
+
     Conn::~Conn() {
         /** Free memory given to error message
          *  **Note**: The connection has its own automatically called destructor
@@ -81,6 +458,10 @@ namespace SQLite {
          *  @param[in] query A SQL query
          */
 
+        // Free the message from the last failure, which sqlite3_exec() would overwrite
+        sqlite3_free(error_message);
+        error_message = nullptr;
+
         if (sqlite3_exec(this->get_ptr(),
             (const char*)query.c_str(),
             0,  // Callback
@@ -89,6 +470,21 @@ namespace SQLite {
             throw SQLiteError(error_message);
     }
 
+    size_t Conn::open_statements() {
+        /** Return the number of prepared statements which have not been
+         *  closed yet, not counting idle ones in the statement cache
+         */
+        return this->base->open_statements();
+    }
+
+    void Conn::close_statements() noexcept {
+        /** Close every prepared statement which is still open, without
+         *  closing the connection. Using them afterwards throws
+         *  StatementClosed.
+         */
+        this->base->close_statements();
+    }
+
     sqlite3* Conn::get_ptr() {
         /**
          * Return a raw pointer to the sqlite3 handle.
@@ -122,20 +518,52 @@ namespace SQLite {
          **/
 
         // https://sqlite.org/c3ref/close.html
+        this->base->close();
+    }
+
+    void Conn::set_cache_capacity(size_t capacity) noexcept {
+        /** Set how many idle prepared statements are kept for reuse by
+         *  prepare() and query(). Setting this to zero disables caching.
+         */
+        this->base->cache.set_capacity(capacity);
+    }
 
-        PreparedStatement* stmt;
+    size_t Conn::get_cache_capacity() {
+        /** Return the maximum number of idle prepared statements kept */
+        return this->base->cache.get_capacity();
+    }
 
-        /* Deallocate prepared statements
-         * Note: This should be completely harmless,
-         * even if some of the stmts are nullptrs/have been closed
+    StatementCache::Stats Conn::get_cache_stats() {
+        /** Return the statement cache's hit, miss, and eviction counters */
+        return this->base->cache.get_stats();
+    }
+
+    void Conn::set_slow_query_log(std::function<void(const SlowQuery&)> sink,
+        const SlowQueryOptions& options) {
+        /** Report statements stepped through PreparedStatement::next() or
+         *  ResultSet::next() which take longer than options.threshold.
+         *  For queries, the time of every step until the last row is added
+         *  up. Pass a null sink to turn the log off.
+         *
+         *  The sink is called on the thread running the statement, before
+         *  the statement returns.
+         *
+         *  **Example**
+         *  ```
+         *  db.set_slow_query_log([](const SQLite::SlowQuery& query) {
+         *      std::cerr << query.sql << " took " << query.elapsed.count() << "ns" << std::endl;
+         *      for (auto& step : query.plan) std::cerr << "  " << step << std::endl;
+         *  });
+         *  ```
          */
-        while (!this->stmts.empty()) {
-            stmt = this->stmts.front();
-            stmt->close();
-            this->stmts.pop();
+        if (sink) {
+            this->base->slow_log.reset(new SlowQueryLog());
+            this->base->slow_log->sink = std::move(sink);
+            this->base->slow_log->options = options;
+        }
+        else {
+            this->base->slow_log.reset();
         }
-
-        this->base->close();
     }
 
     //
@@ -150,16 +578,23 @@ namespace SQLite {
          */
 
         this->conn = &conn;
-        conn.stmts.push(this);
-        int result = sqlite3_prepare_v2(
-            this->conn->get_ptr(),       /* Database handle */
-            (const char *)stmt.c_str(),  /* SQL statement, UTF-8 encoded */
-            stmt.size(),                 /* Maximum length of zSql in bytes. */
-            &(this->base->stmt),         /* OUT: Statement handle */
-            &(this->unused)              /* OUT: Pointer to unused portion of zSql */
-        );
+        sqlite3* db = this->conn->get_ptr();
+        conn.base->link(this->base.get());
+        this->base->conn = conn.base;
+        this->base->stmt = conn.base->cache.take(stmt, this->base->sql);
+
+        if (!this->base->stmt) {
+            int result = sqlite3_prepare_v2(
+                db,                          /* Database handle */
+                (const char *)stmt.c_str(),  /* SQL statement, UTF-8 encoded */
+                stmt.size(),                 /* Maximum length of zSql in bytes. */
+                &(this->base->stmt),         /* OUT: Statement handle */
+                &(this->unused)              /* OUT: Pointer to unused portion of zSql */
+            );
 
-        // explain_sqlite_error(result);
+            if (result != SQLITE_OK)
+                throw SQLiteError(sqlite3_errmsg(db));
+        }
 
         this->params = sqlite3_bind_parameter_count(this->get_ptr());
     }
@@ -176,8 +611,11 @@ namespace SQLite {
     }
     
     Conn::PreparedStatement Conn::prepare(const std::string& stmt) {
-        /** Prepare a query for execution */
-        this->exec("BEGIN TRANSACTION");
+        /** Prepare a query for execution
+         *
+         *  Each step is committed on its own unless a Transaction is active,
+         *  so wrap many writes in a Transaction to commit them together.
+         */
         return Conn::PreparedStatement(*this, stmt);
     }
 
@@ -186,9 +624,19 @@ namespace SQLite {
         return Conn::ResultSet(*this, stmt);
     }
 
+    Transaction Conn::transaction(TransactionMode mode) {
+        /** Begin a transaction, or a savepoint if one is already active */
+        return Transaction(*this, mode);
+    }
+
     void Conn::PreparedStatement::commit() {
-        /** End a transaction */
-        this->conn->exec("END TRANSACTION");
+        /** Close the statement, first committing any transaction begun with
+         *  exec("BEGIN"). Transactions owned by a Transaction object are
+         *  left for it to commit.
+         */
+        auto& db_base = *this->conn->base;
+        if (!sqlite3_get_autocommit(db_base.db) && db_base.transaction_depth == 0)
+            db_base.transactions.commit(db_base.db);
         this->close();
     }
 
@@ -200,13 +648,275 @@ namespace SQLite {
     void Conn::PreparedStatement::next() {
         /** Call after bind()-ing values to execute statement */
 
+        using clock = std::chrono::steady_clock;
+        SlowQueryLog* slow_log = this->conn->base->slow_log.get();
+        clock::time_point start;
+        if (slow_log) start = clock::now();
+
         int result = sqlite3_step(this->get_ptr());
+        if (slow_log) slow_log->report(this->get_ptr(), clock::now() - start);
         int ext_res = sqlite3_extended_errcode(this->conn->get_ptr());
         if (result != 101 || sqlite3_reset(this->get_ptr()) != 0) {
-            // Rollback transaction on failure
-            this->conn->exec("ROLLBACK");
+            // Saved before rolling back, which replaces the message
+            std::string detail = sqlite3_errmsg(this->conn->get_ptr());
+
+            // Rollback transactions begun with exec("BEGIN") on failure,
+            // while Transaction objects roll back when they are destroyed
+            auto& db_base = *this->conn->base;
+            if (!sqlite3_get_autocommit(db_base.db) && db_base.transaction_depth == 0) {
+                try {
+                    db_base.transactions.rollback(db_base.db);
+                }
+                catch (SQLiteError&) {}
+            }
             this->base->close();
-            throw_sqlite_error(result, ext_res);
+            throw_sqlite_error(result, ext_res, detail);
+        }
+    }
+
+    //
+    // BlobStream
+    //
+
+    BlobStream Conn::open_blob(const std::string& table, const std::string& column,
+        long long int rowid, bool writable) {
+        /** Open the BLOB stored in table.column of the row with the given
+         *  rowid for incremental I/O
+         *  @param[in] writable Whether the BLOB may be written to
+         */
+        return BlobStream(*this, table, column, rowid, writable);
+    }
+
+    BlobStream::BlobStream(Conn& conn, const std::string& table,
+        const std::string& column, long long int rowid, bool writable) {
+        /** @see Conn::open_blob() */
+        sqlite3* db = conn.get_ptr();
+        this->conn = conn.base;
+        if (sqlite3_blob_open(db, "main", table.c_str(), column.c_str(),
+                rowid, writable, &this->blob) != SQLITE_OK) {
+            std::string msg = sqlite3_errmsg(db);
+            this->close(); // A handle may be returned even on failure
+            throw SQLiteError(msg);
+        }
+
+        this->length = sqlite3_blob_bytes(this->blob);
+    }
+
+    BlobStream::BlobStream(BlobStream&& other) noexcept :
+        blob(other.blob), conn(std::move(other.conn)),
+        offset(other.offset), length(other.length) {
+        other.blob = nullptr;
+    }
+
+    BlobStream& BlobStream::operator=(BlobStream&& other) noexcept {
+        if (this != &other) {
+            this->close();
+            this->blob = other.blob;
+            this->conn = std::move(other.conn);
+            this->offset = other.offset;
+            this->length = other.length;
+            other.blob = nullptr;
+        }
+
+        return *this;
+    }
+
+    sqlite3_blob* BlobStream::get_ptr() {
+        /** Get a raw pointer to the underlying sqlite3_blob
+         *
+         *  #### Memory Safety
+         *  Throws DatabaseClosed if the connection has been closed, or
+         *  StatementClosed if the stream has been.
+         */
+        auto db_base = this->conn.lock();
+        if (!db_base || !db_base->db) throw DatabaseClosed();
+        if (!this->blob) throw StatementClosed();
+        return this->blob;
+    }
+
+    void BlobStream::check(int result) {
+        if (result != SQLITE_OK) {
+            auto db_base = this->conn.lock();
+            throw SQLiteError(db_base && db_base->db ?
+                sqlite3_errmsg(db_base->db) : sqlite3_errstr(result));
+        }
+    }
+
+    void BlobStream::seek(size_t pos) {
+        /** Move the position of the next read or write */
+        if (pos > this->length)
+            throw ValueError("Cannot seek to " + std::to_string(pos) +
+                " in a BLOB of " + std::to_string(this->length) + " bytes");
+        this->offset = pos;
+    }
+
+    size_t BlobStream::read(void* buffer, size_t n) {
+        /** Read up to n bytes into buffer, advancing the position
+         *
+         *  @returns The number of bytes read, which is only less than n
+         *           at the end of the BLOB
+         */
+        n = std::min(n, this->length - this->offset);
+        if (n) {
+            this->check(sqlite3_blob_read(this->get_ptr(), buffer, (int)n, (int)this->offset));
+            this->offset += n;
+        }
+
+        return n;
+    }
+
+    void BlobStream::write(const void* data, size_t n) {
+        /** Write n bytes at the current position, advancing it
+         *
+         *  #### Safety
+         *  A ValueError is thrown if the write would run past the end of
+         *  the BLOB, since BLOBs cannot be resized in place.
+         */
+        if (n > this->length - this->offset)
+            throw ValueError("Writing " + std::to_string(n) + " bytes at offset " +
+                std::to_string(this->offset) + " would overflow a BLOB of " +
+                std::to_string(this->length) + " bytes");
+
+        if (n) {
+            this->check(sqlite3_blob_write(this->get_ptr(), data, (int)n, (int)this->offset));
+            this->offset += n;
+        }
+    }
+
+    size_t BlobStream::copy_to(std::ostream& out, size_t chunk_size) {
+        /** Write the rest of the BLOB to out, chunk_size bytes at a time
+         *  @returns The number of bytes copied
+         */
+        std::unique_ptr<char[]> buffer(new char[chunk_size]);
+        size_t total = 0;
+        while (size_t n = this->read(buffer.get(), chunk_size)) {
+            out.write(buffer.get(), n);
+            total += n;
+        }
+
+        return total;
+    }
+
+    size_t BlobStream::copy_from(std::istream& in, size_t chunk_size) {
+        /** Fill the rest of the BLOB with data read from in, chunk_size
+         *  bytes at a time, stopping early if in runs out
+         *  @returns The number of bytes copied
+         */
+        if (!chunk_size)
+            throw ValueError("chunk_size must be at least 1");
+
+        std::unique_ptr<char[]> buffer(new char[chunk_size]);
+        size_t total = 0;
+        while (this->offset < this->length && in) {
+            in.read(buffer.get(), std::min(chunk_size, this->length - this->offset));
+            size_t n = (size_t)in.gcount();
+            this->write(buffer.get(), n);
+            total += n;
+        }
+
+        return total;
+    }
+
+    void BlobStream::reopen(long long int rowid) {
+        /** Point the stream at the same column of another row, which is
+         *  much faster than opening a new stream
+         */
+        this->check(sqlite3_blob_reopen(this->get_ptr(), rowid));
+        this->offset = 0;
+        this->length = sqlite3_blob_bytes(this->blob);
+    }
+
+    void BlobStream::close() noexcept {
+        /** Close the BLOB handle. Calling close() more than once is harmless. */
+        if (this->blob) {
+            sqlite3_blob_close(this->blob);
+            this->blob = nullptr;
+        }
+    }
+
+    //
+    // Transaction
+    //
+
+    Transaction::Transaction(Conn& conn, TransactionMode mode) : conn(conn.base) {
+        /** Begin a transaction with the given locking mode, or a savepoint
+         *  if a transaction is already active. The mode has no effect on
+         *  savepoints.
+         */
+        sqlite3* db = conn.get_ptr();
+        auto& db_base = *conn.base;
+        this->level = db_base.transaction_depth;
+        this->savepoint = !sqlite3_get_autocommit(db);
+
+        if (this->savepoint)
+            db_base.transactions.savepoint(db, this->level);
+        else
+            db_base.transactions.begin(db, mode);
+
+        db_base.transaction_depth++;
+    }
+
+    Transaction::Transaction(Transaction&& other) noexcept :
+        conn(std::move(other.conn)), level(other.level),
+        savepoint(other.savepoint), active(other.active) {
+        other.active = false;
+    }
+
+    Transaction::~Transaction() {
+        if (this->active) {
+            try {
+                this->rollback();
+            }
+            catch (...) {}
+        }
+    }
+
+    std::shared_ptr<conn_base> Transaction::lock() {
+        /** Return the connection, checking that this is the innermost
+         *  active transaction
+         */
+        if (!this->active)
+            throw ValueError("Transaction has already been committed or rolled back");
+
+        auto db_base = this->conn.lock();
+        if (!db_base || !db_base->db) throw DatabaseClosed();
+        if (db_base->transaction_depth != this->level + 1)
+            throw ValueError("A nested transaction is still active");
+        return db_base;
+    }
+
+    void Transaction::end(conn_base& db_base) noexcept {
+        this->active = false;
+        db_base.transaction_depth--;
+    }
+
+    void Transaction::commit() {
+        /** Commit the transaction, or release the savepoint into the
+         *  enclosing transaction
+         *
+         *  #### Exception Safety
+         *  If committing fails, e.g. because the database is busy, the
+         *  transaction stays active so commit() can be retried.
+         */
+        auto db_base = this->lock();
+        if (this->savepoint)
+            db_base->transactions.release(db_base->db, this->level);
+        else
+            db_base->transactions.commit(db_base->db);
+        this->end(*db_base);
+    }
+
+    void Transaction::rollback() {
+        /** Undo every change made since the transaction began */
+        auto db_base = this->lock();
+        this->end(*db_base);
+
+        if (this->savepoint) {
+            db_base->transactions.rollback_to(db_base->db, this->level);
+        }
+        else if (!sqlite3_get_autocommit(db_base->db)) {
+            // SQLite may have rolled back already after an error
+            db_base->transactions.rollback(db_base->db);
         }
     }
 
@@ -248,52 +958,61 @@ namespace SQLite {
     }
 
     bool Conn::ResultSet::next(std::vector<SQLField>& row) {
-        /** Fetches the next results from the query, and stores them in row */
+        /** Fetches the next results from the query, and stores them in row
+         *
+         *  Fields are overwritten in place, so reusing the same row across
+         *  calls avoids allocating once its buffers are large enough
+         */
         // https://sqlite.org/capi3ref.html#sqlite3_column_blob
         if (!this->next()) return false;
 
         sqlite3_stmt* stmt = this->get_ptr();
-        std::vector<SQLField> ret;
         int col_size = this->num_cols();
-
-        long long int int_val;
-        double real_val;
-        const unsigned char * text_val;
+        row.resize(col_size);
 
         for (int i = 0; i < col_size; i++) {
-            switch (sqlite3_column_type(
-                this->get_ptr(), i)) {
+            switch (sqlite3_column_type(stmt, i)) {
 
             // Cases are integer macros defined in sqlite3.h
             case SQLITE_INTEGER:
-                int_val = sqlite3_column_int64(stmt, i);
-                ret.push_back(SQLField(int_val));
+                row[i].set_int(sqlite3_column_int64(stmt, i));
                 break;
 
             case SQLITE_FLOAT:
-                real_val = sqlite3_column_double(stmt, i);
-                ret.push_back(SQLField(real_val));
-                break;
-
-            case SQLITE_BLOB: // Not supported yet
+                row[i].set_double(sqlite3_column_double(stmt, i));
                 break;
 
-            case SQLITE_NULL:
-                ret.push_back(SQLField(nullptr));
+            case SQLITE_BLOB:
+                // Call sqlite3_column_blob() before sqlite3_column_bytes()
+                row[i].set_blob(sqlite3_column_blob(stmt, i),
+                    sqlite3_column_bytes(stmt, i));
                 break;
 
             case SQLITE_TEXT:
-                text_val = sqlite3_column_text(stmt, i);
-                ret.push_back(SQLField(std::string((char *)text_val)));
+                row[i].set_text((const char *)sqlite3_column_text(stmt, i),
+                    sqlite3_column_bytes(stmt, i));
                 break;
 
-            default:
+            default: // SQLITE_NULL
+                row[i].set_null();
                 break;
 
             }
         }
 
-        row.swap(ret);
+        return true;
+    }
+
+    bool Conn::ResultSet::next(RowView& row) {
+        /** Fetches the next results from the query, and points row at them
+         *  without copying
+         *
+         *  @see ColumnView for how long the values remain valid
+         */
+        if (!this->next()) return false;
+
+        sqlite3_stmt* stmt = this->get_ptr();
+        row = RowView(stmt, sqlite3_column_count(stmt));
         return true;
     }
 
@@ -302,6 +1021,36 @@ namespace SQLite {
         return sqlite3_column_count(this->get_ptr());
     }
 
+    Conn::ResultSet& Conn::ResultSet::operator=(ResultSet&& other) noexcept {
+        if (this != &other) {
+            this->report_slow(); // The statement being replaced is closed
+            PreparedStatement::operator=(std::move(other));
+            this->done = other.done;
+            this->elapsed = other.elapsed;
+            other.elapsed = std::chrono::nanoseconds(0);
+        }
+
+        return *this;
+    }
+
+    void Conn::ResultSet::close() noexcept {
+        /** Close the query, reporting it to the slow query log if enough
+         *  time was spent reading it, even if not every row was read
+         */
+        this->report_slow();
+        PreparedStatement::close();
+    }
+
+    void Conn::ResultSet::report_slow() noexcept {
+        /** Report time spent stepping which hasn't been reported yet */
+        if (this->elapsed.count() == 0 || !this->base || !this->base->stmt) return;
+
+        auto db_base = this->base->conn.lock();
+        if (db_base && db_base->slow_log)
+            db_base->slow_log->report(this->base->stmt, this->elapsed);
+        this->elapsed = std::chrono::nanoseconds(0);
+    }
+
     bool Conn::ResultSet::next() {
         /** Retrieves the next row from the a SQL result set,
          *  or returns False if we're done
@@ -310,6 +1059,167 @@ namespace SQLite {
         /* 100 --> More rows are available
         * 101 --> Done
         */
-        return (sqlite3_step(this->get_ptr()) == 100);
+        if (this->done) return false;
+
+        using clock = std::chrono::steady_clock;
+        SlowQueryLog* slow_log = this->conn->base->slow_log.get();
+        if (!slow_log) {
+            if (sqlite3_step(this->get_ptr()) == 100) return true;
+        }
+        else {
+            auto start = clock::now();
+            int result = sqlite3_step(this->get_ptr());
+            this->elapsed += clock::now() - start;
+            if (result == 100) return true;
+
+            slow_log->report(this->get_ptr(), this->elapsed);
+            this->elapsed = std::chrono::nanoseconds(0);
+        }
+
+        this->done = true;
+        return false;
+    }
+
+    /** Return the type implied by a column's declared type, or SQLITE_NULL
+     *  if it can't be determined (https://sqlite.org/datatype3.html)
+     */
+    static int declared_type(sqlite3_stmt* stmt, int i) {
+        const char* decltype_str = sqlite3_column_decltype(stmt, i);
+        if (!decltype_str) return SQLITE_NULL; // Expression
+
+        std::string decl(decltype_str);
+        for (auto& ch : decl) ch = (char)toupper(ch);
+
+        if (decl.find("INT") != std::string::npos) return SQLITE_INTEGER;
+        if (decl.find("CHAR") != std::string::npos || decl.find("CLOB") != std::string::npos
+            || decl.find("TEXT") != std::string::npos) return SQLITE_TEXT;
+        if (decl.empty() || decl.find("BLOB") != std::string::npos) return SQLITE_BLOB;
+        if (decl.find("REAL") != std::string::npos || decl.find("FLOA") != std::string::npos
+            || decl.find("DOUB") != std::string::npos) return SQLITE_FLOAT;
+        return SQLITE_NULL; // NUMERIC affinity: could be either number type
+    }
+
+    /** Append placeholder values for rows rows to a typed column */
+    static void pad_column(Column& col, size_t rows) {
+        switch (col.type) {
+        case SQLITE_INTEGER:
+            col.ints.resize(col.ints.size() + rows);
+            break;
+        case SQLITE_FLOAT:
+            col.reals.resize(col.reals.size() + rows);
+            break;
+        case SQLITE_TEXT:
+        case SQLITE_BLOB:
+            col.offsets.resize(col.offsets.size() + rows, col.offsets.back());
+            break;
+        }
+    }
+
+    /** Convert the values already in a column to a wider type, so that a
+     *  value of that type can be stored without losing data. Types widen
+     *  in the order INTEGER, FLOAT, TEXT, BLOB, and numbers become the
+     *  same text SQLite would produce.
+     */
+    static void widen_column(Column& col, int type) {
+        if (col.type == SQLITE_INTEGER && type == SQLITE_FLOAT) {
+            col.reals.assign(col.ints.begin(), col.ints.end());
+            col.ints.clear();
+        }
+        else if (col.type == SQLITE_INTEGER || col.type == SQLITE_FLOAT) {
+            size_t count = col.type == SQLITE_INTEGER ? col.ints.size() : col.reals.size();
+            char buffer[32];
+            for (size_t row = 0; row < count; row++) {
+                if (!col.is_null(row)) {
+                    if (col.type == SQLITE_INTEGER)
+                        sqlite3_snprintf(sizeof(buffer), buffer, "%lld", col.ints[row]);
+                    else
+                        sqlite3_snprintf(sizeof(buffer), buffer, "%!.15g", col.reals[row]);
+                    col.bytes += buffer;
+                }
+
+                col.offsets.push_back(col.bytes.size());
+            }
+
+            col.ints.clear();
+            col.reals.clear();
+        }
+
+        col.type = type;
+    }
+
+    size_t Conn::ResultSet::next_batch(ColumnBatch& batch, size_t max_rows) {
+        /** Fetch up to max_rows rows and store them column by column in batch,
+         *  replacing its previous contents
+         *
+         *  @returns The number of rows fetched, or zero once the results
+         *           are exhausted
+         */
+        sqlite3_stmt* stmt = this->get_ptr();
+        int col_size = this->num_cols();
+
+        batch.names.resize(col_size);
+        batch.columns.resize(col_size);
+        batch.rows = 0;
+
+        for (int i = 0; i < col_size; i++) {
+            Column& col = batch.columns[i];
+            batch.names[i] = sqlite3_column_name(stmt, i);
+            col.type = declared_type(stmt, i);
+            col.ints.clear();
+            col.reals.clear();
+            col.offsets.assign(1, 0);
+            col.bytes.clear();
+            col.validity.clear();
+            col.null_count = 0;
+        }
+
+        size_t& rows = batch.rows;
+        for (; rows < max_rows && this->next(); rows++) {
+            for (int i = 0; i < col_size; i++) {
+                Column& col = batch.columns[i];
+                if (rows % 8 == 0) col.validity.push_back(0);
+
+                int type = sqlite3_column_type(stmt, i);
+                if (type == SQLITE_NULL) {
+                    col.null_count++;
+                    pad_column(col, 1);
+                    continue;
+                }
+
+                col.validity.back() |= (unsigned char)(1 << (rows % 8));
+                if (col.type == SQLITE_NULL) {
+                    // Type determined by first non-NULL value
+                    col.type = type;
+                    pad_column(col, rows);
+                }
+                else if (type > col.type) {
+                    // A value that would lose data if converted, e.g.
+                    // text in an INT column
+                    widen_column(col, type);
+                }
+
+                switch (col.type) {
+                case SQLITE_INTEGER:
+                    col.ints.push_back(sqlite3_column_int64(stmt, i));
+                    break;
+                case SQLITE_FLOAT:
+                    col.reals.push_back(sqlite3_column_double(stmt, i));
+                    break;
+                case SQLITE_TEXT:
+                    // Call sqlite3_column_text() before sqlite3_column_bytes()
+                    col.bytes.append((const char *)sqlite3_column_text(stmt, i),
+                        sqlite3_column_bytes(stmt, i));
+                    col.offsets.push_back(col.bytes.size());
+                    break;
+                case SQLITE_BLOB:
+                    col.bytes.append((const char *)sqlite3_column_blob(stmt, i),
+                        sqlite3_column_bytes(stmt, i));
+                    col.offsets.push_back(col.bytes.size());
+                    break;
+                }
+            }
+        }
+
+        return rows;
     }
 }
\ No newline at end of file
@@ -30,16 +30,29 @@ SOFTWARE.
 
 /** @file */
 
+#pragma once
 extern "C" {
     #include "sqlite3.h"
 }
 
 #include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <iosfwd>
 #include <map>
-#include <queue>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <unordered_map>
 #include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
 
 /** @SQLite
  */
@@ -84,82 +97,957 @@ namespace SQLite {
         { 1555, "SQLITE_CONSTRAINT_PRIMARYKEY: Primary key constraint failed" }
     };
     
-    /** Return type for SQL queries */
+    /** A non-owning view over binary data */
+    struct BlobView {
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+    };
+
+    /** An owning buffer of binary data */
+    using Blob = std::vector<unsigned char>;
+
+    /** Binds a BLOB of size zero bytes, reserving space which can be
+     *  filled in later through a BlobStream
+     */
+    struct ZeroBlob {
+        size_t size = 0;
+    };
+
+    /** Return type for SQL queries
+     *
+     *  A tagged value holding a NULL, an integer, a float, text, or a blob.
+     *  Numbers are stored inline, while text and blobs share one
+     *  std::string buffer, so short values never allocate and reassigning
+     *  a field reuses its existing capacity.
+     */
     class SQLField {
-        struct SQLFieldConcept {
-            virtual ~SQLFieldConcept() {};
-            virtual size_t type() = 0;
-        };
+    public:
+        SQLField() {};
+        SQLField(std::nullptr_t) {};
+        SQLField(int val) { this->set_int(val); }
+        SQLField(long int val) { this->set_int(val); }
+        SQLField(long long int val) { this->set_int(val); }
+        SQLField(double val) { this->set_double(val); }
+        SQLField(const char* val) { this->set_text(val, strlen(val)); }
+        SQLField(const std::string& val) { this->set_text(val.data(), val.size()); }
+        SQLField(std::string_view val) { this->set_text(val.data(), val.size()); }
+        SQLField(BlobView val) { this->set_blob(val.data, val.size); }
+        SQLField(const Blob& val) { this->set_blob(val.data(), val.size()); }
+
+        /** Return the fundamental SQLite3 type */
+        size_t type() const { return this->tag; }
+
+        /** Return the stored value
+         *
+         *  #### Safety
+         *  A ValueError is thrown if T does not match the stored type.
+         */
+        template<typename T> T get() const;
 
-        template<typename T> struct SQLFieldModel : SQLFieldConcept {
-            SQLFieldModel(const T& t) : value(t) {};
-            size_t type(); /**< Return the fundamental SQLite3 type */
-            T value;
+        /** @name In-Place Assignment
+         *  Overwrite the field, reusing previously allocated storage
+         */
+        ///@{
+        void set_null() { this->tag = SQLITE_NULL; }
+        void set_int(long long int val) {
+            this->tag = SQLITE_INTEGER;
+            this->int_val = val;
+        }
+
+        void set_double(double val) {
+            this->tag = SQLITE_FLOAT;
+            this->real_val = val;
+        }
+
+        void set_text(const char* val, size_t size) {
+            this->tag = SQLITE_TEXT;
+            this->bytes.assign(val, size);
+        }
+
+        void set_blob(const void* val, size_t size) {
+            this->tag = SQLITE_BLOB;
+            this->bytes.assign((const char *)val, size);
+        }
+        ///@}
+
+    private:
+        void check_type(int expected) const {
+            if (this->tag != expected)
+                throw ValueError("SQLField holds type " + std::to_string(this->tag) +
+                    ", not " + std::to_string(expected));
+        }
+
+        int tag = SQLITE_NULL;
+        union {
+            long long int int_val;
+            double real_val;
         };
+        std::string bytes; /**< Text or blob contents */
+    };
 
-        std::shared_ptr<SQLFieldConcept> value;
+    template<>
+    inline long long int SQLField::get() const {
+        this->check_type(SQLITE_INTEGER);
+        return this->int_val;
+    }
 
+    template<>
+    inline long int SQLField::get() const {
+        this->check_type(SQLITE_INTEGER);
+        return (long int)this->int_val;
+    }
+
+    template<>
+    inline double SQLField::get() const {
+        this->check_type(SQLITE_FLOAT);
+        return this->real_val;
+    }
+
+    template<>
+    inline std::nullptr_t SQLField::get() const {
+        this->check_type(SQLITE_NULL);
+        return nullptr;
+    }
+
+    template<>
+    inline std::string SQLField::get() const {
+        this->check_type(SQLITE_TEXT);
+        return this->bytes;
+    }
+
+    template<>
+    inline std::string_view SQLField::get() const {
+        this->check_type(SQLITE_TEXT);
+        return this->bytes;
+    }
+
+    template<>
+    inline BlobView SQLField::get() const {
+        this->check_type(SQLITE_BLOB);
+        BlobView blob;
+        blob.data = (const unsigned char *)this->bytes.data();
+        blob.size = this->bytes.size();
+        return blob;
+    }
+
+    template<>
+    inline Blob SQLField::get() const {
+        this->check_type(SQLITE_BLOB);
+        return Blob(this->bytes.begin(), this->bytes.end());
+    }
+
+    /** A non-owning view over one column of the current row of a query
+     *
+     *  #### Memory Safety
+     *  Text and blob values point directly into SQLite's buffers, and are
+     *  only valid until the next call to ResultSet::next() or until the
+     *  ResultSet is closed.
+     */
+    class ColumnView {
     public:
-        template<typename T> SQLField(const T& val) :
-            value(new SQLFieldModel<T>(val)) {};
-        template<typename T> T get() { return ((SQLFieldModel<T>*)value.get())->value; }
+        ColumnView(sqlite3_stmt* stmt, int i) : stmt(stmt), i(i) {};
 
-        size_t type() { return value.get()->type(); }
+        /** Return the fundamental SQLite3 type */
+        size_t type() const { return sqlite3_column_type(this->stmt, this->i); }
+        bool is_null() const { return this->type() == SQLITE_NULL; }
+
+        /** Return the value, letting SQLite convert it if necessary */
+        template<typename T> T get() const;
+
+    private:
+        sqlite3_stmt* stmt;
+        int i;
     };
 
     template<>
-    inline size_t SQLField::SQLFieldModel<long long int>::type() { return SQLITE_INTEGER; }
+    inline long long int ColumnView::get() const {
+        return sqlite3_column_int64(this->stmt, this->i);
+    }
 
     template<>
-    inline size_t SQLField::SQLFieldModel<double>::type() { return SQLITE_FLOAT; }
+    inline long int ColumnView::get() const {
+        return (long int)sqlite3_column_int64(this->stmt, this->i);
+    }
 
     template<>
-    inline size_t SQLField::SQLFieldModel<std::nullptr_t>::type() { return SQLITE_NULL; }
+    inline int ColumnView::get() const {
+        return sqlite3_column_int(this->stmt, this->i);
+    }
 
     template<>
-    inline size_t SQLField::SQLFieldModel<std::string>::type() { return SQLITE_TEXT; }
+    inline double ColumnView::get() const {
+        return sqlite3_column_double(this->stmt, this->i);
+    }
+
+    template<>
+    inline std::string_view ColumnView::get() const {
+        // Call sqlite3_column_text() before sqlite3_column_bytes()
+        // https://sqlite.org/c3ref/column_blob.html
+        auto text = (const char *)sqlite3_column_text(this->stmt, this->i);
+        if (!text) return std::string_view();
+        return std::string_view(text, sqlite3_column_bytes(this->stmt, this->i));
+    }
+
+    template<>
+    inline BlobView ColumnView::get() const {
+        BlobView blob;
+        blob.data = (const unsigned char *)sqlite3_column_blob(this->stmt, this->i);
+        blob.size = sqlite3_column_bytes(this->stmt, this->i);
+        return blob;
+    }
+
+    template<>
+    inline Blob ColumnView::get() const {
+        auto blob = this->get<BlobView>();
+        return Blob(blob.data, blob.data + blob.size);
+    }
+
+    /** A non-owning view over the current row of a query, filled in by
+     *  ResultSet::next(RowView&) without any allocations
+     */
+    class RowView {
+    public:
+        RowView() {};
+        RowView(sqlite3_stmt* stmt, int cols) : stmt(stmt), cols(cols) {};
+
+        size_t size() const { return this->cols; }
+        ColumnView operator[](size_t i) const { return ColumnView(this->stmt, (int)i); }
+
+    private:
+        sqlite3_stmt* stmt = nullptr;
+        int cols = 0;
+    };
+
+    /** One column of a ColumnBatch, stored contiguously
+     *
+     *  Only the arrays matching the column's type are filled in:
+     *   - SQLITE_INTEGER: ints
+     *   - SQLITE_FLOAT: reals
+     *   - SQLITE_TEXT and SQLITE_BLOB: the value of row i is
+     *     bytes[offsets[i], offsets[i + 1])
+     *
+     *  NULLs are recorded in validity, a bitmap with one bit per row (least
+     *  significant bit first) which is set if the value is not NULL.
+     *  The layout matches the Apache Arrow columnar format.
+     */
+    struct Column {
+        /** Set by the declared column type, or else the first non-NULL
+         *  value in the batch. Narrower values are converted by SQLite,
+         *  e.g. integers in a REAL column. A wider value, e.g. text in an
+         *  INT column, widens the whole column (INTEGER to FLOAT to TEXT
+         *  to BLOB) so that no data is lost.
+         *  SQLITE_NULL means every value in the batch was NULL.
+         */
+        int type = SQLITE_NULL;
+        std::vector<long long int> ints;
+        std::vector<double> reals;
+        std::vector<long long int> offsets;
+        std::string bytes;
+        std::vector<unsigned char> validity;
+        size_t null_count = 0;
+
+        bool is_null(size_t row) const { return !(this->validity[row / 8] & (1 << (row % 8))); }
+
+        /** Return the value of one row
+         *
+         *  #### Memory Safety
+         *  T must match the column's type, and row must be less than
+         *  ColumnBatch::rows.
+         */
+        template<typename T> T get(size_t row) const;
+    };
+
+    template<>
+    inline long long int Column::get(size_t row) const { return this->ints[row]; }
+
+    template<>
+    inline double Column::get(size_t row) const { return this->reals[row]; }
+
+    template<>
+    inline std::string_view Column::get(size_t row) const {
+        return std::string_view(this->bytes.data() + this->offsets[row],
+            (size_t)(this->offsets[row + 1] - this->offsets[row]));
+    }
+
+    template<>
+    inline BlobView Column::get(size_t row) const {
+        BlobView blob;
+        blob.data = (const unsigned char *)this->bytes.data() + this->offsets[row];
+        blob.size = (size_t)(this->offsets[row + 1] - this->offsets[row]);
+        return blob;
+    }
+
+    /** A block of query results pivoted into columns, filled in by
+     *  ResultSet::next_batch()
+     *
+     *  Reusing the same batch across calls keeps its buffers, so steady
+     *  state scanning does not allocate. The exception is export_arrow(),
+     *  which takes the buffers, so the next batch allocates new ones.
+     */
+    struct ColumnBatch {
+        std::vector<std::string> names;
+        std::vector<Column> columns;
+        size_t rows = 0;
+    };
+
+    /** @name Typed Rows
+     *  Helpers for Conn::query_as()
+     */
+    ///@{
+    /** Describes how to fill a struct from a row, for use with Conn::query_as()
+     *
+     *  Specialize this for each struct with a tuple of member pointers,
+     *  listed in column order:
+     *  ```
+     *  template<> struct SQLite::RowMapping<Player> {
+     *      static constexpr auto members = std::make_tuple(
+     *          &Player::name, &Player::touchdowns, &Player::rating);
+     *  };
+     *  ```
+     */
+    template<typename T>
+    struct RowMapping;
+
+    /** Read one column into out with a direct sqlite3_column_* call */
+    template<typename T>
+    inline void read_column(const ColumnView& col, T& out) {
+        out = col.get<T>();
+    }
+
+    /** Read one column into a string, reusing its capacity */
+    inline void read_column(const ColumnView& col, std::string& out) {
+        auto text = col.get<std::string_view>();
+        out.assign(text.data(), text.size());
+    }
+
+    /** Read one column into a blob, reusing its capacity */
+    inline void read_column(const ColumnView& col, Blob& out) {
+        auto blob = col.get<BlobView>();
+        out.assign(blob.data, blob.data + blob.size);
+    }
+
+    /** Read one column, mapping NULL to std::nullopt */
+    template<typename T>
+    inline void read_column(const ColumnView& col, std::optional<T>& out) {
+        if (col.is_null()) {
+            out.reset();
+        }
+        else {
+            if (!out) out.emplace();
+            read_column(col, *out);
+        }
+    }
+
+    template<typename T>
+    struct is_tuple : std::false_type {};
+
+    template<typename... Ts>
+    struct is_tuple<std::tuple<Ts...>> : std::true_type {};
+    ///@}
+
+    /** @name User Defined Function Helpers
+     *  Helpers for Conn::create_function()
+     */
+    ///@{
+    /** Deduces the return and argument types of a function pointer,
+     *  lambda, or other function object with one operator()
+     */
+    template<typename F>
+    struct function_traits : function_traits<decltype(&F::operator())> {};
+
+    template<typename Ret, typename... Args>
+    struct function_traits<Ret(*)(Args...)> {
+        using return_type = Ret;
+        using args = std::tuple<typename std::decay<Args>::type...>;
+        static constexpr size_t arity = sizeof...(Args);
+    };
+
+    template<typename Ret, typename... Args>
+    struct function_traits<Ret(Args...)> : function_traits<Ret(*)(Args...)> {};
+
+    template<typename C, typename Ret, typename... Args>
+    struct function_traits<Ret(C::*)(Args...)> : function_traits<Ret(*)(Args...)> {};
+
+    template<typename C, typename Ret, typename... Args>
+    struct function_traits<Ret(C::*)(Args...) const> : function_traits<Ret(*)(Args...)> {};
+
+    template<typename T>
+    struct is_optional : std::false_type {};
+
+    template<typename T>
+    struct is_optional<std::optional<T>> : std::true_type {};
+
+    /** Convert a function argument with a direct sqlite3_value_* call.
+     *  NULL becomes std::nullopt if T is a std::optional, or else zero or
+     *  an empty value.
+     *
+     *  #### Memory Safety
+     *  std::string_view and BlobView point into SQLite's copy of the
+     *  value, and are only valid until the function returns.
+     */
+    template<typename T>
+    inline T read_value(sqlite3_value* value) {
+        if constexpr (is_optional<T>::value) {
+            if (sqlite3_value_type(value) == SQLITE_NULL) return std::nullopt;
+            return read_value<typename T::value_type>(value);
+        }
+        else if constexpr (std::is_same<T, sqlite3_value*>::value) {
+            return value;
+        }
+        else if constexpr (std::is_integral<T>::value) {
+            return (T)sqlite3_value_int64(value);
+        }
+        else if constexpr (std::is_floating_point<T>::value) {
+            return (T)sqlite3_value_double(value);
+        }
+        else if constexpr (std::is_same<T, std::string_view>::value ||
+            std::is_same<T, std::string>::value) {
+            auto text = (const char*)sqlite3_value_text(value);
+            return T(text ? text : "", (size_t)sqlite3_value_bytes(value));
+        }
+        else if constexpr (std::is_same<T, BlobView>::value ||
+            std::is_same<T, Blob>::value) {
+            BlobView blob;
+            blob.data = (const unsigned char *)sqlite3_value_blob(value);
+            blob.size = (size_t)sqlite3_value_bytes(value);
+            if constexpr (std::is_same<T, Blob>::value)
+                return Blob(blob.data, blob.data + blob.size);
+            else
+                return blob;
+        }
+        else {
+            static_assert(std::is_void<T>::value && false,
+                "Unsupported argument type for a user defined function");
+        }
+    }
+
+    /** @name Function Results
+     *  Return a value from a user defined function with a direct
+     *  sqlite3_result_* call
+     */
+    ///@{
+    template<typename T>
+    inline typename std::enable_if<std::is_integral<T>::value>::type
+    result_value(sqlite3_context* context, T value) {
+        sqlite3_result_int64(context, (sqlite3_int64)value);
+    }
+
+    template<typename T>
+    inline typename std::enable_if<std::is_floating_point<T>::value>::type
+    result_value(sqlite3_context* context, T value) {
+        sqlite3_result_double(context, (double)value);
+    }
+
+    inline void result_value(sqlite3_context* context, std::string_view value) {
+        sqlite3_result_text64(context, value.data(), (sqlite3_uint64)value.size(),
+            SQLITE_TRANSIENT, SQLITE_UTF8);
+    }
+
+    inline void result_value(sqlite3_context* context, const std::string& value) {
+        result_value(context, std::string_view(value));
+    }
+
+    inline void result_value(sqlite3_context* context, const char* value) {
+        if (value) result_value(context, std::string_view(value));
+        else sqlite3_result_null(context);
+    }
+
+    inline void result_value(sqlite3_context* context, BlobView value) {
+        // Zero-length blobs need a non-NULL pointer, or SQLite returns NULL
+        sqlite3_result_blob64(context, value.data ? (const void*)value.data : "",
+            (sqlite3_uint64)value.size, SQLITE_TRANSIENT);
+    }
+
+    inline void result_value(sqlite3_context* context, const Blob& value) {
+        result_value(context, BlobView{ value.data(), value.size() });
+    }
+
+    inline void result_value(sqlite3_context* context, std::nullptr_t) {
+        sqlite3_result_null(context);
+    }
+
+    template<typename T>
+    inline void result_value(sqlite3_context* context, const std::optional<T>& value) {
+        if (value) result_value(context, *value);
+        else sqlite3_result_null(context);
+    }
+    ///@}
+
+    inline void result_exception(sqlite3_context* context) noexcept {
+        /** Report the exception being handled as an SQL error */
+        try {
+            throw;
+        }
+        catch (std::bad_alloc&) {
+            sqlite3_result_error_nomem(context);
+        }
+        catch (std::exception& e) {
+            sqlite3_result_error(context, e.what(), -1);
+        }
+        catch (...) {
+            sqlite3_result_error(context, "Unknown exception in user defined function", -1);
+        }
+    }
+
+    /** Call func with each argument converted to the type in Args */
+    template<typename Args, typename F, size_t... I>
+    inline decltype(auto) apply_values(F&& func, sqlite3_value** argv, std::index_sequence<I...>) {
+        return func(read_value<typename std::tuple_element<I, Args>::type>(argv[I])...);
+    }
+
+    /** The xFunc callback given to sqlite3_create_function_v2(), which
+     *  unpacks each argument into the type F expects and calls it
+     */
+    template<typename F>
+    inline void call_function(sqlite3_context* context, sqlite3_value** argv) {
+        using Traits = function_traits<F>;
+        using Args = typename Traits::args;
+        F& func = *(F*)sqlite3_user_data(context);
+        auto seq = std::make_index_sequence<Traits::arity>();
+
+        try {
+            if constexpr (std::is_void<typename Traits::return_type>::value) {
+                apply_values<Args>(func, argv, seq);
+                sqlite3_result_null(context);
+            }
+            else {
+                result_value(context, apply_values<Args>(func, argv, seq));
+            }
+        }
+        catch (...) {
+            result_exception(context);
+        }
+    }
+
+    /** Fixed size slots for one aggregate function's per-group state,
+     *  carved out of blocks so that starting a group doesn't allocate
+     *
+     *  Slots freed by finished groups are reused first. Once no group is
+     *  live, i.e. every statement using the function has finished or been
+     *  reset, all but the newest block are freed and the arena starts over
+     *  from the beginning of that block. So memory only outlives a
+     *  statement as one block, which the next statement reuses.
+     */
+    template<typename T>
+    class AggregateArena {
+    public:
+        AggregateArena() {};
+        AggregateArena(const AggregateArena&) = delete;
+        AggregateArena& operator=(const AggregateArena&) = delete;
+
+        T* create() {
+            /** Default construct a T in a free slot */
+            Slot* slot = this->free_slots;
+            if (!slot) {
+                if (this->used == this->capacity) this->grow();
+                slot = &this->blocks.back()[this->used];
+            }
+
+            T* obj = new (slot->storage) T();
+
+            // Only once the constructor succeeds
+            if (slot == this->free_slots) this->free_slots = slot->next;
+            else this->used++;
+            this->live++;
+            return obj;
+        }
+
+        void destroy(T* obj) noexcept {
+            /** Destroy an object made by create() and recycle its slot */
+            obj->~T();
+            Slot* slot = reinterpret_cast<Slot*>(obj);
+            slot->next = this->free_slots;
+            this->free_slots = slot;
+            if (--this->live == 0) this->reset();
+        }
+
+        size_t blocks_held() const { return this->blocks.size(); }
+
+    private:
+        union Slot {
+            Slot* next;
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+        static constexpr size_t MIN_BLOCK_SIZE = 16;   /**< Slots in the first block */
+        static constexpr size_t MAX_BLOCK_SIZE = 1024; /**< Blocks double up to this */
+
+        void grow() {
+            size_t size = std::min(std::max(this->capacity * 2, MIN_BLOCK_SIZE), MAX_BLOCK_SIZE);
+            this->blocks.emplace_back(new Slot[size]);
+            this->capacity = size;
+            this->used = 0;
+        }
+
+        void reset() noexcept {
+            /** Forget every slot, keeping only the newest (largest) block */
+            if (this->blocks.size() > 1)
+                this->blocks.erase(this->blocks.begin(), this->blocks.end() - 1);
+            this->free_slots = nullptr;
+            this->used = 0;
+        }
+
+        std::vector<std::unique_ptr<Slot[]>> blocks;
+        size_t capacity = 0;         /**< Slots in the newest block */
+        size_t used = 0;             /**< Slots of the newest block handed out */
+        size_t live = 0;             /**< Objects not yet destroyed */
+        Slot* free_slots = nullptr;  /**< Slots returned since the last reset */
+    };
+
+    template<typename T, typename = void>
+    struct has_inverse : std::false_type {};
+
+    template<typename T>
+    struct has_inverse<T, std::void_t<decltype(&T::inverse)>> : std::true_type {};
+
+    /** Callbacks for Conn::create_aggregate(). The aggregate context only
+     *  holds a pointer to Agg, which lives in the function's AggregateArena.
+     *  Being pointer sized, SQLite can always take the context from the
+     *  connection's lookaside memory.
+     */
+    template<typename Agg>
+    struct AggregateCallbacks {
+        using Arena = AggregateArena<Agg>;
+        using Args = typename function_traits<decltype(&Agg::step)>::args;
+        static constexpr size_t arity = std::tuple_size<Args>::value;
+
+        static Agg* get_state(sqlite3_context* context) {
+            /** Return the current group's state, creating it if needed */
+            Agg** state = (Agg**)sqlite3_aggregate_context(context, sizeof(Agg*));
+            if (!state) throw std::bad_alloc();
+            if (!*state) *state = ((Arena*)sqlite3_user_data(context))->create();
+            return *state;
+        }
+
+        static void step(sqlite3_context* context, int, sqlite3_value** argv) {
+            try {
+                Agg* agg = get_state(context);
+                apply_values<Args>([agg](auto&&... args) {
+                    agg->step(std::forward<decltype(args)>(args)...);
+                }, argv, std::make_index_sequence<arity>());
+            }
+            catch (...) {
+                result_exception(context);
+            }
+        }
+
+        static void finalize(sqlite3_context* context) {
+            // Called once per group, including after errors and when a
+            // statement is reset early, so this is where the state is
+            // destroyed
+            Agg** state = (Agg**)sqlite3_aggregate_context(context, 0);
+            try {
+                if (state && *state) {
+                    result_value(context, (*state)->result());
+                }
+                else {
+                    Agg empty; // No rows
+                    result_value(context, empty.result());
+                }
+            }
+            catch (...) {
+                result_exception(context);
+            }
+
+            if (state && *state) {
+                ((Arena*)sqlite3_user_data(context))->destroy(*state);
+                *state = nullptr;
+            }
+        }
+
+        static void value(sqlite3_context* context) {
+            try {
+                result_value(context, get_state(context)->result());
+            }
+            catch (...) {
+                result_exception(context);
+            }
+        }
+
+        static void inverse(sqlite3_context* context, int, sqlite3_value** argv) {
+            if constexpr (has_inverse<Agg>::value) {
+                try {
+                    Agg* agg = get_state(context);
+                    apply_values<Args>([agg](auto&&... args) {
+                        agg->inverse(std::forward<decltype(args)>(args)...);
+                    }, argv, std::make_index_sequence<arity>());
+                }
+                catch (...) {
+                    result_exception(context);
+                }
+            }
+        }
+
+        static void destroy(void* arena) {
+            delete (Arena*)arena;
+        }
+    };
+    ///@}
+
+    /** Default number of idle statements kept by a connection's StatementCache */
+    const size_t DEFAULT_CACHE_CAPACITY = 64;
+
+    /** A bounded, least-recently-used pool of idle prepared statements
+     *  keyed by their SQL text
+     *
+     *  Statements are checked out of the cache while in use, so two live
+     *  statements never share a sqlite3_stmt. When a statement is closed it
+     *  is reset and returned here instead of being finalized.
+     */
+    class StatementCache {
+    public:
+        /** Counters describing how effective the cache has been */
+        struct Stats {
+            size_t hits = 0;      /**< Statements reused from the cache */
+            size_t misses = 0;    /**< Statements which had to be prepared */
+            size_t evictions = 0; /**< Idle statements finalized to make room */
+        };
+
+        StatementCache(size_t capacity = DEFAULT_CACHE_CAPACITY) :
+            capacity(capacity) {};
+        ~StatementCache() { this->clear(); }
+
+        sqlite3_stmt* take(const std::string& sql, std::string& key);
+        void put(std::string& key, sqlite3_stmt* stmt) noexcept;
+        void clear() noexcept;
+        void set_capacity(size_t new_capacity) noexcept;
+        size_t get_capacity() const { return this->capacity; }
+        size_t size() const { return this->entries.size(); }
+        Stats get_stats() const { return this->stats; }
+
+    private:
+        using Entry = std::pair<std::string, sqlite3_stmt*>;
+        void evict() noexcept;
+
+        std::list<Entry> entries; /**< Idle statements, most recently used first */
+        std::unordered_map<std::string_view,
+            std::list<Entry>::iterator> index; /**< Views into entries' keys */
+        size_t capacity;
+        Stats stats;
+    };
+
+    /** How a Transaction acquires locks when it begins
+     *  (https://sqlite.org/lang_transaction.html)
+     */
+    enum class TransactionMode {
+        DEFERRED,  /**< Lock the database when it is first read or written */
+        IMMEDIATE, /**< Take the write lock right away */
+        EXCLUSIVE  /**< Also prevent other connections from reading */
+    };
+
+    /** The statements used by Transaction, prepared the first time they are
+     *  needed and kept for the life of the connection, so that beginning
+     *  and ending a transaction never reparses SQL
+     */
+    class TransactionStatements {
+    public:
+        TransactionStatements() {};
+        TransactionStatements(const TransactionStatements&) = delete;
+        TransactionStatements& operator=(const TransactionStatements&) = delete;
+        ~TransactionStatements() { this->clear(); }
+
+        void begin(sqlite3* db, TransactionMode mode);
+        void commit(sqlite3* db);
+        void rollback(sqlite3* db);
+        void savepoint(sqlite3* db, size_t level);
+        void release(sqlite3* db, size_t level);
+        void rollback_to(sqlite3* db, size_t level);
+        void clear() noexcept;
+
+    private:
+        /** Statements for the savepoint at one nesting level */
+        struct Savepoint {
+            sqlite3_stmt* savepoint = nullptr;
+            sqlite3_stmt* release = nullptr;
+            sqlite3_stmt* rollback_to = nullptr;
+        };
+
+        static void prepare(sqlite3* db, sqlite3_stmt*& stmt, const std::string& sql);
+        static void run(sqlite3* db, sqlite3_stmt*& stmt, const char* sql);
+        Savepoint& get_savepoint(sqlite3* db, size_t level);
+
+        sqlite3_stmt* begin_stmts[3] = {}; /**< By TransactionMode */
+        sqlite3_stmt* commit_stmt = nullptr;
+        sqlite3_stmt* rollback_stmt = nullptr;
+        std::vector<Savepoint> savepoints; /**< By nesting level */
+    };
+
+    /** A statement which ran for longer than SlowQueryOptions::threshold */
+    struct SlowQuery {
+        std::string sql;                /**< SQL text as prepared */
+        std::string expanded_sql;       /**< SQL text with bound values filled in,
+                                         *   empty if redacted */
+        std::chrono::nanoseconds elapsed;
+        std::vector<std::string> plan;  /**< EXPLAIN QUERY PLAN output, one line per step */
+    };
+
+    /** Controls what Conn::set_slow_query_log() reports */
+    struct SlowQueryOptions {
+        std::chrono::microseconds threshold =
+            std::chrono::milliseconds(100); /**< Report statements slower than this */
+        bool redact = true;   /**< Leave out bound values, which may be sensitive */
+        bool explain = true;  /**< Capture the query plan */
+    };
+
+    /** Times statements and reports the slow ones to a sink */
+    struct SlowQueryLog {
+        std::function<void(const SlowQuery&)> sink;
+        SlowQueryOptions options;
+
+        void report(sqlite3_stmt* stmt, std::chrono::nanoseconds elapsed) noexcept {
+            if (elapsed >= this->options.threshold)
+                this->log(stmt, elapsed);
+        }
+
+    private:
+        void log(sqlite3_stmt* stmt, std::chrono::nanoseconds elapsed) noexcept;
+    };
+
+    struct stmt_base;
 
     /** Wrapper over a sqlite3 pointer */
     struct conn_base {
     public:
         sqlite3* db = nullptr;
+        StatementCache cache; /**< Idle statements available for reuse */
+        std::unique_ptr<SlowQueryLog> slow_log; /**< Null unless enabled */
+        TransactionStatements transactions;     /**< Used by Transaction */
+        size_t transaction_depth = 0;           /**< Number of active Transactions */
 
         /** Return a reference to the sqlite pointer */
         sqlite3** get_ref() {
             return &(this->db);
         }
-        
-        void close() {
-            if (db) {
-                sqlite3_close(db);
-                db = nullptr;
-            }
-        };
+
+        /** @name Statement Registry
+         *  Statements in use, which are closed along with the connection.
+         *  Each one unlinks itself when it is closed, so the list only
+         *  ever holds live statements.
+         */
+        ///@{
+        void link(stmt_base* stmt) noexcept;
+        void unlink(stmt_base* stmt) noexcept;
+        size_t open_statements() const { return this->stmt_count; }
+        void close_statements() noexcept;
+        ///@}
+
+        void close() noexcept;
         conn_base() {};
+        conn_base(const conn_base&) = delete;
+        conn_base& operator=(const conn_base&) = delete;
         ~conn_base() {
             this->close();
         }
+
+    private:
+        stmt_base* stmts = nullptr; /**< Most recently linked statement */
+        size_t stmt_count = 0;
     };
 
     /** Wrapper over a sqlite3_stmt pointer */
     struct stmt_base {
     public:
         stmt_base() {};
+        stmt_base(const stmt_base&) = delete;
+        stmt_base& operator=(const stmt_base&) = delete;
         ~stmt_base() {
-            // Note: Calling sqlite3_finalize on a nullptr is harmless
-            sqlite3_finalize(this->stmt);
+            this->close();
         }
 
-        void close() {
+        /** Return the statement to its connection's cache, or finalize it
+         *  if the connection is gone
+         */
+        void close() noexcept {
+            if (registry) registry->unlink(this);
             if (stmt) {
-                sqlite3_finalize(stmt);
+                auto db_base = conn.lock();
+                if (db_base && db_base->db)
+                    db_base->cache.put(sql, stmt);
+                else
+                    sqlite3_finalize(stmt);
+
                 stmt = nullptr;
+                owned.clear(); // No longer bound
             }
         }
 
         sqlite3_stmt* stmt = nullptr;
+        std::weak_ptr<conn_base> conn; /**< Connection which owns the cache */
+        std::string sql;               /**< Cache key */
+        std::vector<std::string> owned; /**< Strings moved into bind(), by parameter */
+
+        /** @name Statement Registry Links
+         *  Only set while linked into registry by conn_base::link()
+         */
+        ///@{
+        conn_base* registry = nullptr;
+        stmt_base* prev = nullptr;
+        stmt_base* next = nullptr;
+        ///@}
     };
 
+    /** Controls how Conn::BulkInsert batches rows */
+    struct BulkInsertOptions {
+        /** Maximum rows per multi-row INSERT statement. Zero means as many
+         *  as SQLite's host parameter limit allows.
+         */
+        size_t rows_per_statement = 0;
+        size_t rows_per_transaction = 100000; /**< Commit after this many rows */
+        size_t bytes_per_transaction = 64 << 20; /**< ...or after roughly this many bytes */
+    };
+
+    /** Values for PRAGMA synchronous (https://sqlite.org/pragma.html#pragma_synchronous) */
+    enum class Synchronous {
+        DEFAULT, /**< Leave SQLite's default (FULL) alone */
+        OFF,     /**< Never sync. Fast, but a power loss can corrupt the database. */
+        NORMAL,  /**< Sync less often. Safe in WAL mode, though a power loss
+                  *   may lose the most recent commits. */
+        FULL,    /**< Sync on every commit */
+        EXTRA    /**< Also sync the directory after deleting a rollback journal */
+    };
+
+    /** Values for PRAGMA temp_store (https://sqlite.org/pragma.html#pragma_temp_store) */
+    enum class TempStore {
+        DEFAULT, /**< Leave SQLite's default alone */
+        FILE,    /**< Temporary tables and indices are kept on disk */
+        MEMORY   /**< Temporary tables and indices are kept in memory */
+    };
+
+    /** Settings applied by Conn when it opens a database. Each one is left
+     *  at SQLite's default unless changed.
+     */
+    struct ConnOptions {
+        bool wal = false;           /**< Switch the database to write-ahead logging */
+        Synchronous synchronous = Synchronous::DEFAULT;
+        long long int mmap_size = -1;  /**< Bytes of the file to memory map, or -1 */
+        long long int cache_size = 0;  /**< Page cache size: pages if positive,
+                                        *   KiB if negative, or 0 for the default */
+        TempStore temp_store = TempStore::DEFAULT;
+        int busy_timeout = 0;       /**< Milliseconds to retry a locked database */
+        int wal_autocheckpoint = -1; /**< Pages written before committing runs a
+                                      *   checkpoint, 0 to never do so, or -1 */
+
+        /** @name Open Flags
+         *  Passed to sqlite3_open_v2() rather than set by pragmas
+         */
+        ///@{
+        bool read_only = false;     /**< Open with SQLITE_OPEN_READONLY, failing if
+                                     *   the database doesn't exist */
+        bool immutable = false;     /**< Promise the file never changes, so SQLite
+                                     *   skips locking and change detection.
+                                     *   Implies read_only. */
+        bool nomutex = false;       /**< Skip SQLite's per-connection mutex. The
+                                     *   connection must then only be used by
+                                     *   one thread at a time. */
+        ///@}
+
+        static ConnOptions wal_profile();
+        static ConnOptions snapshot_profile();
+    };
+
+    class BlobStream;
+    class Transaction;
+
     /** Connection to a SQLite database */
     class Conn {
 
@@ -175,6 +1063,10 @@ namespace SQLite {
                 /** Bind any number of arguments to the statement and
                  *  automatically call next()
                  *
+                 *  Arguments are taken by value, so std::string arguments
+                 *  passed with std::move() are handed to the statement
+                 *  without being copied again.
+                 *
                  *  #### Safety
                  *  If too many arguments are bound, an error will be thrown at runtime.
                  */
@@ -184,8 +1076,7 @@ namespace SQLite {
                         std::to_string(this->params) + " expected " + std::to_string(sizeof...(Args)) + " specified");
                 }
 
-                size_t i = 0;
-                _bind_many(i, args...); // Recurse through templates
+                _bind_many(0, args...); // Recurse through templates
                 this->next();
             }
 
@@ -193,6 +1084,8 @@ namespace SQLite {
             void bind(const size_t i, const T& value) {
                 bind<T>(i, value);
             }
+
+            void bind(const size_t i, std::string&& value);
             ///@}
 
             sqlite3_stmt* get_ptr();
@@ -204,22 +1097,27 @@ namespace SQLite {
             int params;
             Conn* conn;
             std::shared_ptr<stmt_base> base = std::make_shared<stmt_base>();
-            const char * unused;
+            const char * unused = nullptr;
 
         private:
             /** @name Variadic bind() Helpers */
             ///@{
+            void _bind_many(size_t) {}
+
+            template<typename T, typename... Args>
+            void _bind_many(size_t i, T& value, Args&... args) {
+                _bind_one(i, value);
+                _bind_many(i + 1, args...); // Recurse through templates
+            }
+
             template<typename T>
-            void _bind_many(size_t i, T& value) {
+            void _bind_one(size_t i, T& value) {
                 bind<T>(i, value);
-                i++;
             }
 
-            template<typename T, typename... Args>
-            void _bind_many(size_t i, T& value, Args... args) {
-                bind<T>(i, value);
-                i++;
-                _bind_many(i, args...); // Recurse through templates
+            void _bind_one(size_t i, std::string& value) {
+                // bind(Args...) owns its arguments, so they can be moved from
+                this->bind(i, std::move(value));
             }
             ///@}
         };
@@ -227,42 +1125,143 @@ namespace SQLite {
         /** Class for representing results from a SQL query */
         class ResultSet : PreparedStatement {
         public:
+            ResultSet(ResultSet&& other) = default;
+            ResultSet& operator=(ResultSet&& other) noexcept;
+            ~ResultSet() { this->report_slow(); }
+
             std::vector<std::string> get_col_names();
             std::vector<std::string> get_row();
             std::vector<SQLField> get_values();
             int num_cols();
             bool next(std::vector<std::string>& row);
             bool next(std::vector<SQLField>& row);
-            using PreparedStatement::close;
+            bool next(RowView& row);
+            size_t next_batch(ColumnBatch& batch, size_t max_rows);
+
+            template<typename T>
+            void bind(const size_t i, const T& value) {
+                /** Bind a value to the i-th (zero-indexed) parameter of the
+                 *  query. Must be called before the first call to next().
+                 */
+                PreparedStatement::bind<T>(i, value);
+            }
+
+            void close() noexcept;
             using PreparedStatement::PreparedStatement;
         private:
             bool next();
+            void report_slow() noexcept;
+            bool done = false; /**< Stepping again would restart the query */
+            std::chrono::nanoseconds elapsed =
+                std::chrono::nanoseconds(0); /**< Time spent stepping, for the slow query log */
         };
 
     public:
+        template<typename... Cols>
+        class BulkInsert;
+
+        template<typename Row>
+        class TypedResultSet;
+
         Conn(const char * db_name);
         Conn(const std::string& db_name);
+        Conn(const std::string& db_name, const ConnOptions& options);
         ~Conn();
         void exec(const std::string& query);
         Conn::PreparedStatement prepare(const std::string& stmt);
         Conn::ResultSet query(const std::string& stmt);
+        Transaction transaction(TransactionMode mode = TransactionMode::DEFERRED);
         void close() noexcept;
 
+        template<typename Row>
+        TypedResultSet<Row> query_as(const std::string& stmt);
+
+        BlobStream open_blob(const std::string& table, const std::string& column,
+            long long int rowid, bool writable = false);
+
+        template<typename F>
+        void create_function(const std::string& name, F func, bool deterministic = false);
+
+        template<typename Agg>
+        void create_aggregate(const std::string& name, bool deterministic = false);
+
+        template<typename... Cols>
+        BulkInsert<Cols...> bulk_insert(const std::string& table,
+            const std::vector<std::string>& columns = {},
+            const BulkInsertOptions& options = BulkInsertOptions());
+
+        /** @name Statement Cache */
+        ///@{
+        void set_cache_capacity(size_t capacity) noexcept;
+        size_t get_cache_capacity();
+        StatementCache::Stats get_cache_stats();
+        ///@}
+
+        void set_slow_query_log(std::function<void(const SlowQuery&)> sink,
+            const SlowQueryOptions& options = SlowQueryOptions());
+
+        size_t open_statements();
+        void close_statements() noexcept;
         sqlite3* get_ptr();
         std::shared_ptr<conn_base> base =
             std::make_shared<conn_base>(); /** Database handle */
         char * error_message = nullptr;    /** Buffer for error messages */
-    private:
-        std::queue<PreparedStatement*> stmts; /** Keep track of prepared statements
-                                               *  so we can dealloc them on close() */
     };
 
     void throw_sqlite_error(const int& error_code,
-        const int& ext_error_code=-1);
+        const int& ext_error_code=-1, const std::string& detail="");
     ///@}
+
+    /** A transaction which is rolled back unless commit() is called before
+     *  it goes out of scope
+     *
+     *  Transactions nest: if a transaction is already active when another
+     *  is created, the inner one becomes a SAVEPOINT, which can be rolled
+     *  back on its own. Any number of prepared statements may be used
+     *  inside one transaction, so that their writes share a single commit.
+     *
+     *  **Example**
+     *  ```
+     *  auto txn = db.transaction(SQLite::TransactionMode::IMMEDIATE);
+     *  auto stmt = db.prepare("INSERT INTO dillydilly VALUES (?,?,?)");
+     *  stmt.bind("Tom Brady", 28, 7);
+     *  {
+     *      SQLite::Transaction savepoint(db);
+     *      stmt.bind("Drew Brees", 21, 7);
+     *  }   // Drew Brees is rolled back
+     *  txn.commit();
+     *  ```
+     *
+     *  #### Safety
+     *  Nested transactions must be committed or rolled back before the
+     *  ones containing them, or else a ValueError is thrown.
+     */
+    class Transaction {
+    public:
+        Transaction(Conn& conn, TransactionMode mode = TransactionMode::DEFERRED);
+        Transaction(Transaction&& other) noexcept;
+        Transaction(const Transaction&) = delete;
+        Transaction& operator=(const Transaction&) = delete;
+        Transaction& operator=(Transaction&&) = delete;
+        ~Transaction();
+
+        void commit();
+        void rollback();
+        bool is_active() const { return this->active; }
+        bool is_savepoint() const { return this->savepoint; }
+
+    private:
+        std::shared_ptr<conn_base> lock();
+        void end(conn_base& db_base) noexcept;
+
+        std::weak_ptr<conn_base> conn;
+        size_t level;               /**< Number of transactions this one is nested in */
+        bool savepoint = false;     /**< False for a top-level transaction */
+        bool active = true;
+    };
     
     template<>
-    inline void Conn::PreparedStatement::bind(const size_t i, const char*& value) {
+    inline void Conn::PreparedStatement::bind(const size_t i, const char* const& value) {
         sqlite3_bind_text(
             this->get_ptr(),    // Pointer to prepared statement
             i + 1,              // Index of parameter to set
@@ -286,6 +1285,40 @@ namespace SQLite {
             SQLITE_TRANSIENT);  // String destructor
     }
 
+    template<>
+    inline void Conn::PreparedStatement::bind(const size_t i, const std::string_view& value) {
+        /** Bind text to the statement without copying it
+         *
+         *  #### Memory Safety
+         *  The caller must keep the text alive until the statement has
+         *  been stepped, e.g. by passing it to the variadic bind().
+         */
+        sqlite3_bind_text64(this->get_ptr(), i + 1,
+            value.data() ? value.data() : "", value.size(),
+            SQLITE_STATIC, SQLITE_UTF8);
+    }
+
+    inline void Conn::PreparedStatement::bind(const size_t i, std::string&& value) {
+        /** Bind text to the statement by taking ownership of the string,
+         *  instead of having SQLite copy it
+         *
+         *  The string is kept by the statement until the parameter is
+         *  bound again or the statement is closed.
+         */
+        sqlite3_stmt* stmt = this->get_ptr();
+
+        // Sized once, so rebinding one slot never moves the others
+        auto& owned = this->base->owned;
+        if (owned.size() < (size_t)this->params)
+            owned.resize(this->params);
+        if (i >= owned.size())
+            throw ValueError("Parameter index " + std::to_string(i) + " out of range");
+
+        owned[i] = std::move(value);
+        sqlite3_bind_text64(stmt, i + 1, owned[i].data(), owned[i].size(),
+            SQLITE_STATIC, SQLITE_UTF8);
+    }
+
     template<>
     inline void Conn::PreparedStatement::bind(const size_t i, const int& value) {
         /** Bind integer values to the statement */
@@ -314,4 +1347,492 @@ namespace SQLite {
     inline void Conn::PreparedStatement::bind(const size_t i, const std::nullptr_t& value) {
         sqlite3_bind_null(this->get_ptr(), i + 1);
     }
-}
\ No newline at end of file
+
+    template<>
+    inline void Conn::PreparedStatement::bind(const size_t i, const BlobView& value) {
+        /** Bind binary data to the statement without copying it
+         *
+         *  #### Memory Safety
+         *  The caller must keep the data alive until the statement has
+         *  been stepped, e.g. by passing it to the variadic bind().
+         */
+        if (!value.data) // sqlite3_bind_blob() would bind NULL
+            sqlite3_bind_zeroblob(this->get_ptr(), i + 1, 0);
+        else
+            sqlite3_bind_blob64(this->get_ptr(), i + 1, value.data,
+                value.size, SQLITE_STATIC);
+    }
+
+    template<>
+    inline void Conn::PreparedStatement::bind(const size_t i, const Blob& value) {
+        /** Bind binary data to the statement */
+        if (value.empty()) // sqlite3_bind_blob() would bind NULL
+            sqlite3_bind_zeroblob(this->get_ptr(), i + 1, 0);
+        else
+            sqlite3_bind_blob64(this->get_ptr(), i + 1, value.data(),
+                value.size(), SQLITE_TRANSIENT);
+    }
+
+    template<>
+    inline void Conn::PreparedStatement::bind(const size_t i, const ZeroBlob& value) {
+        /** Bind a BLOB filled with zeroes, without allocating a buffer for it */
+        int result = sqlite3_bind_zeroblob64(this->get_ptr(), i + 1, value.size);
+        if (result != SQLITE_OK)
+            throw SQLiteError(sqlite3_errstr(result));
+    }
+
+    /** Reads and writes a single BLOB in place, in chunks, so it never
+     *  has to be loaded into memory at once
+     *
+     *  The size of a BLOB cannot be changed through a BlobStream. To write
+     *  a new BLOB, first insert a ZeroBlob of the final size, then fill it in.
+     *
+     *  **Example**
+     *  ```
+     *  auto stmt = db.prepare("INSERT INTO images (data) VALUES (?)");
+     *  stmt.bind(SQLite::ZeroBlob{ file_size });
+     *  stmt.commit();
+     *
+     *  auto blob = db.open_blob("images", "data", sqlite3_last_insert_rowid(db.get_ptr()), true);
+     *  blob.copy_from(infile);
+     *  ```
+     *
+     *  #### Memory Safety
+     *  If the row is changed or deleted while the stream is open, further
+     *  reads and writes throw a SQLiteError. After the connection is closed,
+     *  they throw DatabaseClosed.
+     */
+    class BlobStream {
+    public:
+        BlobStream(Conn& conn, const std::string& table, const std::string& column,
+            long long int rowid, bool writable = false);
+        BlobStream(BlobStream&& other) noexcept;
+        BlobStream& operator=(BlobStream&& other) noexcept;
+        BlobStream(const BlobStream&) = delete;
+        BlobStream& operator=(const BlobStream&) = delete;
+        ~BlobStream() { this->close(); }
+
+        size_t size() const { return this->length; }
+        size_t tell() const { return this->offset; }
+        void seek(size_t pos);
+
+        size_t read(void* buffer, size_t n);
+        void write(const void* data, size_t n);
+        size_t copy_to(std::ostream& out, size_t chunk_size = 1 << 16);
+        size_t copy_from(std::istream& in, size_t chunk_size = 1 << 16);
+
+        void reopen(long long int rowid);
+        void close() noexcept;
+        sqlite3_blob* get_ptr();
+
+    private:
+        void check(int result);
+
+        sqlite3_blob* blob = nullptr;
+        std::weak_ptr<conn_base> conn; /**< Connection the BLOB was opened on */
+        size_t offset = 0;             /**< Position of the next read or write */
+        size_t length = 0;             /**< Size of the BLOB in bytes */
+    };
+
+    /** Loads rows into a table using multi-row INSERT statements, committing
+     *  the work in bounded transactions
+     *
+     *  Rows are buffered until enough have arrived to fill an
+     *  `INSERT ... VALUES (?,?),(?,?),...` statement sized to SQLite's host
+     *  parameter limit, which is then bound and stepped once. A transaction
+     *  is opened automatically and committed every
+     *  BulkInsertOptions::rows_per_transaction rows or
+     *  BulkInsertOptions::bytes_per_transaction bytes.
+     *
+     *  If a transaction is already active when the loader is created, each
+     *  batch is written in a savepoint instead, and the enclosing
+     *  transaction is left to the caller to commit.
+     *
+     *  #### Exception Safety
+     *  Rows which have not been committed when the BulkInsert is destroyed
+     *  are rolled back, so call commit() once all rows have been inserted.
+     */
+    template<typename... Cols>
+    class Conn::BulkInsert {
+    public:
+        /** Counters describing the work done so far */
+        struct Stats {
+            size_t rows = 0;         /**< Rows written to the database */
+            size_t statements = 0;   /**< INSERT statements stepped */
+            size_t transactions = 0; /**< Transactions committed */
+        };
+
+        BulkInsert(Conn& conn, const std::string& table,
+            const std::vector<std::string>& columns,
+            const BulkInsertOptions& options) : conn(&conn), table(table),
+            columns(columns), options(options) {
+            /** Prepare a loader for table
+             *  @param[in] columns Names of the columns being inserted,
+             *                     or empty to insert every column in order
+             */
+            if (!columns.empty() && columns.size() != sizeof...(Cols))
+                throw ValueError(std::to_string(columns.size()) + " column names given for " +
+                    std::to_string(sizeof...(Cols)) + " values per row");
+
+            size_t max_params = sqlite3_limit(conn.get_ptr(), SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+            this->batch_size = std::max<size_t>(1, max_params / sizeof...(Cols));
+            if (options.rows_per_statement)
+                this->batch_size = std::min(this->batch_size, options.rows_per_statement);
+            if (options.rows_per_transaction)
+                this->batch_size = std::min(this->batch_size, options.rows_per_transaction);
+
+            this->pending.reserve(this->batch_size);
+        }
+
+        BulkInsert(const BulkInsert&) = delete;
+        BulkInsert& operator=(const BulkInsert&) = delete;
+
+        /** Queue one row for insertion */
+        void insert(const Cols&... values) {
+            this->pending.emplace_back(values...);
+            if (this->pending.size() == this->batch_size)
+                this->flush();
+        }
+
+        /** Queue one row for insertion */
+        void insert(const std::tuple<Cols...>& row) {
+            this->pending.push_back(row);
+            if (this->pending.size() == this->batch_size)
+                this->flush();
+        }
+
+        /** Queue every row from a range of std::tuple<Cols...> */
+        template<typename Range>
+        void insert_all(const Range& rows) {
+            for (auto& row : rows)
+                this->insert(row);
+        }
+
+        /** Write any buffered rows and commit the current transaction */
+        void commit() {
+            this->flush();
+            this->end_transaction();
+        }
+
+        Stats get_stats() const { return this->stats; }
+
+    private:
+        using Row = std::tuple<Cols...>;
+
+        void flush() {
+            /** Execute one INSERT covering every buffered row */
+            if (this->pending.empty()) return;
+            if (!this->txn)
+                this->txn.reset(new Transaction(*this->conn));
+
+            bool full = (this->pending.size() == this->batch_size);
+            std::unique_ptr<PreparedStatement>& stmt = full ? this->full_stmt : this->tail_stmt;
+            if (!stmt || (!full && this->tail_rows != this->pending.size())) {
+                stmt.reset(new PreparedStatement(*this->conn, this->make_sql(this->pending.size())));
+                if (!full) this->tail_rows = this->pending.size();
+            }
+
+            size_t param = 0;
+            for (auto& row : this->pending) {
+                this->bind_row(*stmt, param, row, std::index_sequence_for<Cols...>());
+                param += sizeof...(Cols);
+            }
+
+            try {
+                stmt->next();
+            }
+            catch (...) {
+                // PreparedStatement::next() has already closed the statement
+                this->txn.reset(); // Roll back
+                this->pending.clear();
+                stmt.reset();
+                throw;
+            }
+
+            this->stats.rows += this->pending.size();
+            this->stats.statements++;
+            this->rows_since_commit += this->pending.size();
+            this->pending.clear();
+
+            if ((this->options.rows_per_transaction &&
+                    this->rows_since_commit >= this->options.rows_per_transaction) ||
+                (this->options.bytes_per_transaction &&
+                    this->bytes_since_commit >= this->options.bytes_per_transaction))
+                this->end_transaction();
+        }
+
+        void end_transaction() {
+            if (this->txn) {
+                this->txn->commit();
+                this->txn.reset();
+                this->stats.transactions++;
+            }
+
+            this->rows_since_commit = 0;
+            this->bytes_since_commit = 0;
+        }
+
+        template<size_t... I>
+        void bind_row(PreparedStatement& stmt, size_t param,
+            const Row& row, std::index_sequence<I...>) {
+            // Buffered rows outlive the step, so text can be borrowed
+            (stmt.bind(param + I, borrow(std::get<I>(row))), ...);
+            this->bytes_since_commit += (value_size(std::get<I>(row)) + ...);
+        }
+
+        template<typename T>
+        static const T& borrow(const T& value) { return value; }
+        static std::string_view borrow(const std::string& value) { return value; }
+
+        std::string make_sql(size_t rows) const {
+            /** Build an INSERT statement with placeholders for rows rows */
+            std::string sql = "INSERT INTO " + quote(this->table);
+            if (!this->columns.empty()) {
+                sql += " (";
+                for (size_t i = 0; i < this->columns.size(); i++)
+                    sql += (i ? "," : "") + quote(this->columns[i]);
+                sql += ")";
+            }
+
+            std::string values = "(?";
+            for (size_t i = 1; i < sizeof...(Cols); i++)
+                values += ",?";
+            values += ")";
+
+            sql += " VALUES ";
+            sql.reserve(sql.size() + rows * (values.size() + 1));
+            for (size_t i = 0; i < rows; i++) {
+                if (i) sql += ",";
+                sql += values;
+            }
+
+            return sql;
+        }
+
+        static std::string quote(const std::string& identifier) {
+            std::string ret = "\"";
+            for (char ch : identifier)
+                ret += (ch == '"') ? std::string("\"\"") : std::string(1, ch);
+            return ret + "\"";
+        }
+
+        /** Approximate number of bytes a value adds to the journal */
+        template<typename T>
+        static size_t value_size(const T&) { return sizeof(T); }
+        static size_t value_size(const std::string& value) { return value.size(); }
+        static size_t value_size(std::string_view value) { return value.size(); }
+        static size_t value_size(const char* value) { return strlen(value); }
+
+        Conn* conn;
+        std::string table;
+        std::vector<std::string> columns;
+        BulkInsertOptions options;
+        std::vector<Row> pending;                     /**< Rows not yet written */
+        std::unique_ptr<PreparedStatement> full_stmt; /**< INSERT for batch_size rows */
+        std::unique_ptr<PreparedStatement> tail_stmt; /**< INSERT for a partial batch */
+        std::unique_ptr<Transaction> txn;             /**< Rolled back if not committed */
+        size_t tail_rows = 0;                         /**< Rows covered by tail_stmt */
+        size_t batch_size;
+        size_t rows_since_commit = 0;
+        size_t bytes_since_commit = 0;
+        Stats stats;
+    };
+
+    template<typename... Cols>
+    Conn::BulkInsert<Cols...> Conn::bulk_insert(const std::string& table,
+        const std::vector<std::string>& columns, const BulkInsertOptions& options) {
+        /** Create a loader which inserts rows of Cols... into table
+         *
+         *  **Example**
+         *  ```
+         *  auto loader = db.bulk_insert<std::string, int, int>("dillydilly");
+         *  loader.insert("Tom Brady", 28, 7);
+         *  loader.commit();
+         *  ```
+         */
+        return BulkInsert<Cols...>(*this, table, columns, options);
+    }
+
+    /** Results of a query read straight into tuples or structs
+     *
+     *  Each column is read with the sqlite3_column_* call matching its
+     *  C++ type, chosen at compile time, so there is no per-value type
+     *  dispatch. Supported column types are long long int, long int, int,
+     *  double, std::string, std::string_view, Blob, BlobView, and std::optional
+     *  of any of these for nullable columns.
+     *
+     *  #### Memory Safety
+     *  std::string_view and BlobView columns point into SQLite's buffers,
+     *  and are only valid until the next call to next().
+     */
+    template<typename Row>
+    class Conn::TypedResultSet {
+    public:
+        TypedResultSet(ResultSet results) : results(std::move(results)) {};
+
+        bool next(Row& row) {
+            /** Fetches the next results from the query, and stores them in row
+             *
+             *  #### Safety
+             *  A ValueError is thrown if the query does not return exactly
+             *  as many columns as Row has fields.
+             */
+            if (!this->results.next(this->view)) return false;
+
+            if (!this->checked) {
+                if (this->view.size() != size)
+                    throw ValueError("Query returns " + std::to_string(this->view.size()) +
+                        " columns but the row type has " + std::to_string(size) + " fields");
+                this->checked = true;
+            }
+
+            this->read_row(row, std::make_index_sequence<size>());
+            return true;
+        }
+
+        void close() noexcept { this->results.close(); }
+
+    private:
+        template<typename T, bool = is_tuple<T>::value>
+        struct field_count : std::tuple_size<T> {};
+
+        template<typename T>
+        struct field_count<T, false> :
+            std::tuple_size<typename std::decay<decltype(RowMapping<T>::members)>::type> {};
+
+        static const size_t size = field_count<Row>::value;
+
+        template<size_t... I>
+        void read_row(Row& row, std::index_sequence<I...>) {
+            if constexpr (is_tuple<Row>::value)
+                (read_column(this->view[I], std::get<I>(row)), ...);
+            else
+                (read_column(this->view[I], row.*std::get<I>(RowMapping<Row>::members)), ...);
+        }
+
+        ResultSet results;
+        RowView view;
+        bool checked = false;
+    };
+
+    template<typename Row>
+    Conn::TypedResultSet<Row> Conn::query_as(const std::string& stmt) {
+        /** Run a query whose rows are read into a std::tuple or into a
+         *  struct described by RowMapping
+         *
+         *  **Example**
+         *  ```
+         *  auto results = db.query_as<std::tuple<std::string_view, long long int>>(
+         *      "SELECT Player, Touchdown FROM dillydilly");
+         *  std::tuple<std::string_view, long long int> row;
+         *  while (results.next(row)) {
+         *      // Do stuff with std::get<0>(row), std::get<1>(row)
+         *  }
+         *  ```
+         */
+        return TypedResultSet<Row>(this->query(stmt));
+    }
+
+    template<typename F>
+    void Conn::create_function(const std::string& name, F func, bool deterministic) {
+        /** Register a C++ function, lambda, or function object as an SQL
+         *  function. The number and types of its arguments are deduced from
+         *  its signature, and each call reads them with sqlite3_value_*
+         *  directly.
+         *
+         *  Arguments may be integers, floating point numbers,
+         *  std::string_view, std::string, BlobView, Blob, sqlite3_value*,
+         *  or std::optional of those to tell NULL apart. The return type
+         *  may be any of those except sqlite3_value*, or void to return NULL.
+         *  Exceptions thrown by func become SQL errors.
+         *
+         *  **Example**
+         *  ```
+         *  db.create_function("passer_rating", [](double td, double ints) {
+         *      return td / (ints + 1);
+         *  }, true);
+         *  db.query("SELECT Player, passer_rating(Touchdown, Interception) FROM dillydilly");
+         *  ```
+         *
+         *  @param[in] deterministic Promise that func always returns the
+         *             same result for the same arguments, so SQLite can
+         *             call it fewer times and use it in indices
+         */
+        using Traits = function_traits<F>;
+        static_assert(Traits::arity <= 127, "SQL functions take at most 127 arguments");
+
+        int flags = SQLITE_UTF8 | (deterministic ? SQLITE_DETERMINISTIC : 0);
+        auto xFunc = [](sqlite3_context* context, int, sqlite3_value** argv) {
+            call_function<F>(context, argv);
+        };
+        auto xDestroy = [](void* data) { delete (F*)data; };
+
+        // SQLite calls xDestroy if registering fails, or once the function
+        // is replaced or the connection is closed
+        int result = sqlite3_create_function_v2(this->get_ptr(), name.c_str(),
+            (int)Traits::arity, flags, new F(std::move(func)), xFunc, nullptr, nullptr, xDestroy);
+        if (result != SQLITE_OK)
+            throw SQLiteError(sqlite3_errmsg(this->get_ptr()));
+    }
+
+    template<typename Agg>
+    void Conn::create_aggregate(const std::string& name, bool deterministic) {
+        /** Register a class as an SQL aggregate function
+         *
+         *  Agg must be default constructible, with a `step()` method taking
+         *  the function's arguments (in the same types create_function()
+         *  accepts), and a `result()` method returning its value. One Agg
+         *  is created per group, from an arena owned by the function, so
+         *  groups don't each cost an allocation.
+         *
+         *  If Agg also has an `inverse()` method which undoes `step()`, it
+         *  is registered as a window function, and `result()` must not
+         *  change the state. This needs SQLite 3.25 or later: built against
+         *  older versions, it is registered as a plain aggregate, which
+         *  can't be used with OVER.
+         *
+         *  **Example**
+         *  ```
+         *  struct Mean {
+         *      double sum = 0;
+         *      long long int count = 0;
+         *
+         *      void step(double x) { sum += x; count++; }
+         *      void inverse(double x) { sum -= x; count--; }
+         *      std::optional<double> result() {
+         *          if (!count) return std::nullopt;
+         *          return sum / count;
+         *      }
+         *  };
+         *
+         *  db.create_aggregate<Mean>("mean");
+         *  db.query("SELECT mean(Touchdown) OVER (ROWS 2 PRECEDING) FROM dillydilly");
+         *  ```
+         */
+        using Callbacks = AggregateCallbacks<Agg>;
+        static_assert(Callbacks::arity <= 127, "SQL functions take at most 127 arguments");
+
+        int flags = SQLITE_UTF8 | (deterministic ? SQLITE_DETERMINISTIC : 0);
+        auto arena = new typename Callbacks::Arena();
+        int result;
+
+        // SQLite calls xDestroy if registering fails, or once the function
+        // is replaced or the connection is closed
+#if SQLITE_VERSION_NUMBER >= 3025000
+        if constexpr (has_inverse<Agg>::value) {
+            result = sqlite3_create_window_function(this->get_ptr(), name.c_str(),
+                (int)Callbacks::arity, flags, arena, &Callbacks::step, &Callbacks::finalize,
+                &Callbacks::value, &Callbacks::inverse, &Callbacks::destroy);
+        }
+        else
+#endif
+        {
+            result = sqlite3_create_function_v2(this->get_ptr(), name.c_str(),
+                (int)Callbacks::arity, flags, arena, nullptr, &Callbacks::step,
+                &Callbacks::finalize, &Callbacks::destroy);
+        }
+
+        if (result != SQLITE_OK)
+            throw SQLiteError(sqlite3_errmsg(this->get_ptr()));
+    }
+}
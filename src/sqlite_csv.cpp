@@ -0,0 +1,508 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include "sqlite_csv.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SQLITE_CPP_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace SQLite {
+    namespace {
+        /** A parsed field, stored as an offset so the buffer may grow */
+        struct CSVField {
+            size_t offset;
+            size_t size;
+            bool quoted = false; /**< Empty fields are only NULL if unquoted */
+        };
+
+        /** A buffer holding whole CSV records, plus the location of every field */
+        struct CSVChunk {
+            std::string buffer;
+            std::vector<CSVField> fields; /**< Row-major, cols fields per row */
+            size_t rows = 0;
+            size_t cols = 0;
+        };
+
+#ifdef SQLITE_CPP_SSE2
+        inline int lowest_bit(int mask) {
+#ifdef _MSC_VER
+            unsigned long i;
+            _BitScanForward(&i, mask);
+            return (int)i;
+#else
+            return __builtin_ctz(mask);
+#endif
+        }
+#endif
+
+        const char* find_field_end(const char* p, const char* end, char delim) {
+            /** Return a pointer to the first delimiter or line break in [p, end) */
+#ifdef SQLITE_CPP_SSE2
+            // Compare 16 bytes at a time
+            const __m128i delims = _mm_set1_epi8(delim),
+                newlines = _mm_set1_epi8('\n'),
+                returns = _mm_set1_epi8('\r');
+
+            for (; end - p >= 16; p += 16) {
+                __m128i block = _mm_loadu_si128((const __m128i*)p);
+                __m128i matches = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(block, delims), _mm_cmpeq_epi8(block, newlines)),
+                    _mm_cmpeq_epi8(block, returns));
+
+                int mask = _mm_movemask_epi8(matches);
+                if (mask) return p + lowest_bit(mask);
+            }
+#endif
+
+            for (; p < end; p++) {
+                if (*p == delim || *p == '\n' || *p == '\r') break;
+            }
+
+            return p;
+        }
+
+        /** Splits a CSV stream into chunks of complete records */
+        class CSVParser {
+        public:
+            CSVParser(std::istream& in, const CSVImportOptions& options) :
+                in(in), options(options), skip_header(options.header) {};
+
+            bool next_chunk(CSVChunk& chunk);
+            size_t bytes_read = 0;
+
+        private:
+            size_t parse(CSVChunk& chunk, size_t pos);
+            bool parse_record(CSVChunk& chunk, size_t& pos);
+            void unescape(std::string& buffer, CSVField& field);
+
+            std::istream& in;
+            CSVImportOptions options;
+            std::string leftover; /**< Start of a record split across chunks */
+            bool eof = false;
+            bool skip_header;
+            size_t cols = 0;
+            size_t records = 0;
+        };
+
+        bool CSVParser::next_chunk(CSVChunk& chunk) {
+            /** Fill chunk with as many complete records as fit,
+             *  returning false once the input is exhausted
+             */
+            chunk.buffer.swap(this->leftover);
+            this->leftover.clear();
+            chunk.fields.clear();
+            chunk.rows = 0;
+
+            size_t consumed = 0;
+            do {
+                if (!this->eof) {
+                    // Append the next block of input
+                    size_t old_size = chunk.buffer.size();
+                    chunk.buffer.resize(old_size + this->options.chunk_size);
+                    this->in.read(&chunk.buffer[old_size], this->options.chunk_size);
+                    size_t count = (size_t)this->in.gcount();
+                    chunk.buffer.resize(old_size + count);
+                    this->bytes_read += count;
+                    if (count < this->options.chunk_size) this->eof = true;
+                }
+
+                // Keep reading until at least one record fits
+                consumed = this->parse(chunk, consumed);
+            } while (!chunk.rows && !this->eof);
+
+            this->leftover.assign(chunk.buffer, consumed, std::string::npos);
+            chunk.buffer.resize(consumed);
+            chunk.cols = this->cols;
+            return chunk.rows > 0;
+        }
+
+        size_t CSVParser::parse(CSVChunk& chunk, size_t pos) {
+            /** Parse every complete record in chunk.buffer from pos onwards,
+             *  returning the offset of the first byte which was not consumed
+             */
+            while (pos < chunk.buffer.size()) {
+                size_t start = pos;
+                if (!this->parse_record(chunk, pos))
+                    return start;
+            }
+
+            return pos;
+        }
+
+        bool CSVParser::parse_record(CSVChunk& chunk, size_t& pos) {
+            /** Parse one record starting at pos, returning false if
+             *  the record continues past the end of the buffer
+             */
+            std::string& buffer = chunk.buffer;
+            const char* data = buffer.data();
+            const size_t end = buffer.size();
+            const size_t first = chunk.fields.size();
+            size_t start = pos;
+            std::vector<size_t> escaped; // Fields containing doubled quotes
+
+            while (true) {
+                CSVField field;
+                if (pos < end && data[pos] == this->options.quote) {
+                    // Quoted field: find the closing quote
+                    field.offset = ++pos;
+                    field.quoted = true;
+                    bool has_escapes = false;
+                    while (true) {
+                        auto q = (const char *)memchr(data + pos, this->options.quote, end - pos);
+                        if (!q && this->eof)
+                            throw ValueError("CSV record " + std::to_string(this->records + 1) +
+                                " has an unterminated quoted field");
+
+                        if (!q || (q + 1 == data + end && !this->eof)) {
+                            chunk.fields.resize(first);
+                            return false;
+                        }
+
+                        pos = q - data + 1;
+                        if (pos < end && data[pos] == this->options.quote) {
+                            has_escapes = true;
+                            pos++;
+                            continue;
+                        }
+
+                        field.size = (q - data) - field.offset;
+                        break;
+                    }
+
+                    if (has_escapes)
+                        escaped.push_back(chunk.fields.size());
+
+                    // Ignore anything between the closing quote and the delimiter
+                    pos = find_field_end(data + pos, data + end, this->options.delimiter) - data;
+                }
+                else {
+                    field.offset = pos;
+                    pos = find_field_end(data + pos, data + end, this->options.delimiter) - data;
+                    field.size = pos - field.offset;
+                }
+
+                if (pos == end && !this->eof) {
+                    chunk.fields.resize(first);
+                    return false;
+                }
+
+                chunk.fields.push_back(field);
+                if (pos == end) break;
+
+                char ch = data[pos++];
+                if (ch == this->options.delimiter) {
+                    if (pos == end && this->eof) // Trailing empty field
+                        chunk.fields.push_back(CSVField{ pos, 0 });
+                    else
+                        continue;
+                }
+                else if (ch == '\r') {
+                    if (pos == end && !this->eof) {
+                        chunk.fields.resize(first);
+                        return false;
+                    }
+
+                    if (pos < end && data[pos] == '\n') pos++;
+                }
+
+                break;
+            }
+
+            size_t num_fields = chunk.fields.size() - first;
+
+            // Skip blank lines
+            if (num_fields == 1 && chunk.fields[first].size == 0 && data[start] != this->options.quote) {
+                chunk.fields.resize(first);
+                return true;
+            }
+
+            this->records++;
+            if (!this->cols) {
+                this->cols = num_fields;
+            }
+            else if (num_fields != this->cols) {
+                throw ValueError("CSV record " + std::to_string(this->records) + " has " +
+                    std::to_string(num_fields) + " fields, expected " + std::to_string(this->cols));
+            }
+
+            if (this->skip_header) {
+                this->skip_header = false;
+                chunk.fields.resize(first);
+                return true;
+            }
+
+            for (size_t i : escaped)
+                this->unescape(buffer, chunk.fields[i]);
+
+            chunk.rows++;
+            return true;
+        }
+
+        void CSVParser::unescape(std::string& buffer, CSVField& field) {
+            /** Collapse doubled quotes in place */
+            char* data = &buffer[field.offset];
+            size_t out = 0;
+            for (size_t i = 0; i < field.size; i++, out++) {
+                data[out] = data[i];
+                if (data[i] == this->options.quote) i++;
+            }
+
+            field.size = out;
+        }
+
+        /** Hands filled chunks from the parser thread to the inserting thread */
+        class ChunkQueue {
+        public:
+            static const size_t MAX_CHUNKS = 3;
+
+            std::unique_ptr<CSVChunk> take_empty() {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->cond.wait(lock, [this]() {
+                    return this->cancelled || !this->empty.empty() || this->allocated < MAX_CHUNKS;
+                });
+
+                if (this->cancelled) return nullptr;
+                if (this->empty.empty()) {
+                    this->allocated++;
+                    return std::unique_ptr<CSVChunk>(new CSVChunk());
+                }
+
+                auto chunk = std::move(this->empty.back());
+                this->empty.pop_back();
+                return chunk;
+            }
+
+            std::unique_ptr<CSVChunk> take_full() {
+                /** Return the next parsed chunk, or nullptr when parsing is done */
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->cond.wait(lock, [this]() { return this->done || !this->full.empty(); });
+                if (this->full.empty()) {
+                    if (this->error) std::rethrow_exception(this->error);
+                    return nullptr;
+                }
+
+                auto chunk = std::move(this->full.front());
+                this->full.pop_front();
+                return chunk;
+            }
+
+            void put_full(std::unique_ptr<CSVChunk> chunk) {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->full.push_back(std::move(chunk));
+                this->cond.notify_all();
+            }
+
+            void put_empty(std::unique_ptr<CSVChunk> chunk) {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->empty.push_back(std::move(chunk));
+                this->cond.notify_all();
+            }
+
+            void finish(std::exception_ptr error = nullptr) {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->done = true;
+                this->error = error;
+                this->cond.notify_all();
+            }
+
+            void cancel() {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->cancelled = true;
+                this->cond.notify_all();
+            }
+
+        private:
+            std::mutex mutex;
+            std::condition_variable cond;
+            std::deque<std::unique_ptr<CSVChunk>> full;
+            std::vector<std::unique_ptr<CSVChunk>> empty;
+            size_t allocated = 0;
+            bool done = false;
+            bool cancelled = false;
+            std::exception_ptr error;
+        };
+
+        using PreparedStatement = decltype(std::declval<Conn&>().prepare(std::string()));
+
+        /** Inserts parsed chunks with one reusable prepared statement */
+        class CSVWriter {
+        public:
+            CSVWriter(Conn& conn, const std::string& table, const CSVImportOptions& options) :
+                conn(conn), table(table), options(options) {};
+
+            void write(const CSVChunk& chunk);
+            void finish();
+            size_t rows = 0;
+
+        private:
+            void prepare(size_t cols);
+
+            Conn& conn;
+            std::string table;
+            CSVImportOptions options;
+            std::unique_ptr<PreparedStatement> insert;
+            std::unique_ptr<Transaction> txn; /**< Rolled back if not committed */
+            size_t rows_since_commit = 0;
+        };
+
+        void CSVWriter::prepare(size_t cols) {
+            std::string sql = "INSERT INTO \"";
+            for (char ch : this->table)
+                sql += (ch == '"') ? std::string("\"\"") : std::string(1, ch);
+            sql += "\" VALUES (?";
+            for (size_t i = 1; i < cols; i++)
+                sql += ",?";
+            sql += ")";
+
+            this->insert.reset(new PreparedStatement(this->conn.prepare(sql)));
+        }
+
+        void CSVWriter::write(const CSVChunk& chunk) {
+            /** Insert every row of a chunk. Fields are bound as string
+             *  views without copying since the chunk outlives each step.
+             */
+            if (!chunk.rows) return;
+            if (!this->insert) this->prepare(chunk.cols);
+
+            PreparedStatement& insert = *this->insert;
+            const char* data = chunk.buffer.data();
+            const CSVField* field = chunk.fields.data();
+
+            for (size_t row = 0; row < chunk.rows; row++) {
+                if (!this->txn)
+                    this->txn.reset(new Transaction(this->conn));
+
+                for (size_t col = 0; col < chunk.cols; col++, field++) {
+                    if (!field->size && !field->quoted)
+                        insert.bind(col, nullptr);
+                    else
+                        insert.bind(col, std::string_view(data + field->offset, field->size));
+                }
+
+                insert.next();
+
+                this->rows++;
+                if (++this->rows_since_commit >= this->options.rows_per_transaction)
+                    this->finish();
+            }
+        }
+
+        void CSVWriter::finish() {
+            /** Commit the current transaction */
+            if (this->txn) {
+                this->txn->commit();
+                this->txn.reset();
+            }
+
+            this->rows_since_commit = 0;
+        }
+    }
+
+    double CSVImportStats::rows_per_sec() const {
+        double secs = std::chrono::duration<double>(this->elapsed).count();
+        return secs > 0 ? this->rows / secs : 0;
+    }
+
+    double CSVImportStats::bytes_per_sec() const {
+        double secs = std::chrono::duration<double>(this->elapsed).count();
+        return secs > 0 ? this->bytes / secs : 0;
+    }
+
+    CSVImportStats import_csv(Conn& conn, const std::string& filename,
+        const std::string& table, const CSVImportOptions& options) {
+        /** Insert every row of a CSV file into an existing table
+         *  @param[in] filename Path to a CSV file
+         *  @param[in] table    Name of a table with as many columns as the file
+         */
+        std::ifstream csv(filename, std::ios::binary);
+        if (!csv)
+            throw ValueError("Could not open " + filename);
+
+        return import_csv(conn, csv, table, options);
+    }
+
+    CSVImportStats import_csv(Conn& conn, std::istream& csv,
+        const std::string& table, const CSVImportOptions& options) {
+        /** Insert every row of a CSV stream into an existing table
+         *
+         *  The input is read in chunks of options.chunk_size bytes and
+         *  fields are bound directly from the chunk buffer, so no per-field
+         *  strings are created. When options.threaded is set, the next chunk
+         *  is parsed on a separate thread while the current one is inserted.
+         *
+         *  Rows are inserted in transactions of options.rows_per_transaction
+         *  rows, or in savepoints if a transaction is already active.
+         *  Empty fields are inserted as NULL, unless they are quoted ("").
+         *
+         *  #### Exception Safety
+         *  A ValueError is thrown if a record has the wrong number of fields.
+         *  The transaction in progress is rolled back on failure, although
+         *  previously committed rows remain.
+         */
+        auto start = std::chrono::steady_clock::now();
+        CSVImportOptions opts = options;
+        opts.chunk_size = std::max<size_t>(opts.chunk_size, 1);
+        opts.rows_per_transaction = std::max<size_t>(opts.rows_per_transaction, 1);
+
+        CSVParser parser(csv, opts);
+        CSVWriter writer(conn, table, opts);
+
+        if (opts.threaded) {
+            ChunkQueue queue;
+            std::thread parse_thread([&parser, &queue]() {
+                try {
+                    while (auto chunk = queue.take_empty()) {
+                        if (!parser.next_chunk(*chunk)) break;
+                        queue.put_full(std::move(chunk));
+                    }
+
+                    queue.finish();
+                }
+                catch (...) {
+                    queue.finish(std::current_exception());
+                }
+            });
+
+            try {
+                while (auto chunk = queue.take_full()) {
+                    writer.write(*chunk);
+                    queue.put_empty(std::move(chunk));
+                }
+            }
+            catch (...) {
+                queue.cancel();
+                parse_thread.join();
+                throw;
+            }
+
+            parse_thread.join();
+        }
+        else {
+            CSVChunk chunk;
+            while (parser.next_chunk(chunk))
+                writer.write(chunk);
+        }
+
+        writer.finish();
+
+        CSVImportStats stats;
+        stats.rows = writer.rows;
+        stats.bytes = parser.bytes_read;
+        stats.elapsed = std::chrono::steady_clock::now() - start;
+        return stats;
+    }
+}
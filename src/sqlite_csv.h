@@ -0,0 +1,40 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+/** @file
+ *  Streaming CSV import
+ */
+
+#pragma once
+#include <chrono>
+#include <istream>
+#include "sqlite_cpp.h"
+
+namespace SQLite {
+    /** Controls how import_csv() reads a file */
+    struct CSVImportOptions {
+        char delimiter = ',';
+        char quote = '"';
+        bool header = true;                   /**< Skip the first row */
+        size_t chunk_size = 1 << 22;          /**< Bytes read from the file at a time */
+        size_t rows_per_transaction = 100000; /**< Commit after this many rows */
+        bool threaded = true; /**< Parse on a separate thread while inserting */
+    };
+
+    /** Counters describing a finished import */
+    struct CSVImportStats {
+        size_t rows = 0;  /**< Rows inserted */
+        size_t bytes = 0; /**< Bytes of CSV consumed */
+        std::chrono::nanoseconds elapsed = std::chrono::nanoseconds(0);
+
+        double rows_per_sec() const;
+        double bytes_per_sec() const;
+    };
+
+    CSVImportStats import_csv(Conn& conn, const std::string& filename,
+        const std::string& table, const CSVImportOptions& options = CSVImportOptions());
+    CSVImportStats import_csv(Conn& conn, std::istream& csv,
+        const std::string& table, const CSVImportOptions& options = CSVImportOptions());
+}
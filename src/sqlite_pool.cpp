@@ -0,0 +1,180 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+#include "sqlite_pool.h"
+
+namespace SQLite {
+    //
+    // ConnPool::Lease
+    //
+
+    ConnPool::Lease::Lease(Lease&& other) noexcept :
+        pool(other.pool), conn(other.conn), is_writer(other.is_writer) {
+        other.pool = nullptr;
+        other.conn = nullptr;
+    }
+
+    ConnPool::Lease& ConnPool::Lease::operator=(Lease&& other) noexcept {
+        if (this != &other) {
+            this->release();
+            this->pool = other.pool;
+            this->conn = other.conn;
+            this->is_writer = other.is_writer;
+            other.pool = nullptr;
+            other.conn = nullptr;
+        }
+
+        return *this;
+    }
+
+    Conn* ConnPool::Lease::get() {
+        /** Return the leased connection
+         *
+         *  #### Memory Safety
+         *  A DatabaseClosed error is thrown if the lease has been released.
+         */
+        if (this->conn) {
+            return this->conn;
+        }
+        else {
+            throw DatabaseClosed();
+        }
+    }
+
+    void ConnPool::Lease::release() noexcept {
+        /** Return the connection to the pool early, closing any statements
+         *  still open on it. Calling release() more than once is harmless.
+         */
+        if (this->pool) {
+            // Otherwise the next thread to lease the connection would share
+            // its statement cache and registry with them
+            this->conn->close_statements();
+            this->pool->give_back(this->conn, this->is_writer);
+            this->pool = nullptr;
+            this->conn = nullptr;
+        }
+    }
+
+    //
+    // ConnPool
+    //
+
+    ConnPool::ConnPool(const std::string& db_name, const PoolOptions& options) :
+        options(options) {
+        /** Open the writer and options.readers read-only connections
+         *  @param[in] db_name Path to a SQLite3 database file. In-memory
+         *                     databases cannot be shared between connections.
+         */
+        ConnOptions conn_options = options.connection;
+        conn_options.wal = true;
+        this->writer_conn.reset(new Conn(db_name, conn_options));
+
+        // The writer has already switched the database to WAL mode
+        conn_options.wal = false;
+        for (size_t i = 0; i < options.readers; i++) {
+            this->readers.emplace_back(new Conn(db_name, conn_options));
+            Conn& reader = *this->readers.back();
+            reader.exec("PRAGMA query_only=1");
+            this->idle_readers.push_back(&reader);
+        }
+    }
+
+    ConnPool::Lease ConnPool::reader() {
+        /** Lease a read-only connection, waiting up to the pool's
+         *  lease_timeout for one to become available
+         */
+        return this->reader(this->options.lease_timeout);
+    }
+
+    ConnPool::Lease ConnPool::reader(std::chrono::milliseconds timeout) {
+        /** Lease a read-only connection
+         *
+         *  #### Exception Safety
+         *  A PoolTimeout error is thrown if no connection becomes
+         *  available within timeout.
+         */
+        auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(this->mutex);
+        bool waited = this->idle_readers.empty();
+
+        if (!this->reader_available.wait_for(lock, timeout,
+            [this]() { return !this->idle_readers.empty(); })) {
+            this->stats.timeouts++;
+            throw PoolTimeout();
+        }
+
+        Conn* conn = this->idle_readers.back();
+        this->idle_readers.pop_back();
+        this->stats.readers_in_use++;
+        this->record_wait(start, waited);
+        return Lease(this, conn, false);
+    }
+
+    ConnPool::Lease ConnPool::writer() {
+        /** Lease the writer connection, waiting up to the pool's
+         *  lease_timeout for it to become available
+         */
+        return this->writer(this->options.lease_timeout);
+    }
+
+    ConnPool::Lease ConnPool::writer(std::chrono::milliseconds timeout) {
+        /** Lease the writer connection
+         *
+         *  #### Exception Safety
+         *  A PoolTimeout error is thrown if the writer does not become
+         *  available within timeout.
+         */
+        auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(this->mutex);
+        bool waited = this->writer_busy;
+
+        if (!this->writer_available.wait_for(lock, timeout,
+            [this]() { return !this->writer_busy; })) {
+            this->stats.timeouts++;
+            throw PoolTimeout();
+        }
+
+        this->writer_busy = true;
+        this->stats.writer_in_use = true;
+        this->record_wait(start, waited);
+        return Lease(this, this->writer_conn.get(), true);
+    }
+
+    ConnPool::Stats ConnPool::get_stats() {
+        /** Return a snapshot of the pool's lease and wait-time counters */
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->stats;
+    }
+
+    void ConnPool::give_back(Conn* conn, bool is_writer) noexcept {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (is_writer) {
+                this->writer_busy = false;
+                this->stats.writer_in_use = false;
+            }
+            else {
+                this->idle_readers.push_back(conn);
+                this->stats.readers_in_use--;
+            }
+        }
+
+        if (is_writer)
+            this->writer_available.notify_one();
+        else
+            this->reader_available.notify_one();
+    }
+
+    void ConnPool::record_wait(std::chrono::steady_clock::time_point start, bool waited) {
+        /** Update wait-time counters. Must be called with the mutex held. */
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start);
+
+        this->stats.leases++;
+        if (waited) this->stats.waits++;
+        this->stats.total_wait += elapsed;
+        this->stats.max_wait = std::max(this->stats.max_wait, elapsed);
+    }
+}
@@ -0,0 +1,126 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+/** @file
+ *  A pool of SQLite connections for multi-threaded programs
+ */
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include "sqlite_cpp.h"
+
+namespace SQLite {
+    /** Thrown when a connection could not be leased from a ConnPool in time */
+    class PoolTimeout : public std::runtime_error {
+    public:
+        PoolTimeout() :runtime_error("Timed out waiting for a pooled connection.") {};
+    };
+
+    /** Controls how a ConnPool opens and hands out connections */
+    struct PoolOptions {
+        size_t readers = 4; /**< Number of read-only connections */
+        std::chrono::milliseconds lease_timeout =
+            std::chrono::seconds(5);   /**< How long reader()/writer() wait */
+
+        /** Settings for every connection. WAL mode is always used. */
+        ConnOptions connection = ConnOptions::wal_profile();
+    };
+
+    /** A thread-safe pool of connections to one database, made up of a fixed
+     *  number of read-only connections and a single writer
+     *
+     *  The database is switched to WAL mode, so leased readers can query
+     *  concurrently with each other and with the writer. Each connection is
+     *  only ever used by the thread holding its Lease, and keeps its own
+     *  statement cache.
+     *
+     *  **Example**
+     *  ```
+     *  SQLite::ConnPool pool("database.sqlite");
+     *  {
+     *      auto db = pool.writer();
+     *      db->exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28, 7)");
+     *  }   // Connection is returned to the pool here
+     *
+     *  auto reader = pool.reader();
+     *  auto results = reader->query("SELECT * FROM dillydilly");
+     *  ```
+     *
+     *  #### Memory Safety
+     *  Leases and anything created from a leased connection must not
+     *  outlive the pool. A ResultSet or PreparedStatement must not outlive
+     *  the Lease it was created from either: once the connection is
+     *  returned, another thread may lease it. Any statements still open
+     *  are closed when the lease is released, so using them afterwards
+     *  throws StatementClosed.
+     */
+    class ConnPool {
+    public:
+        /** Exclusive access to one pooled connection, which is returned to
+         *  the pool when the lease is destroyed
+         */
+        class Lease {
+        public:
+            Lease(Lease&& other) noexcept;
+            Lease& operator=(Lease&& other) noexcept;
+            Lease(const Lease&) = delete;
+            Lease& operator=(const Lease&) = delete;
+            ~Lease() { this->release(); }
+
+            Conn& operator*() { return *this->get(); }
+            Conn* operator->() { return this->get(); }
+            Conn* get();
+            void release() noexcept;
+
+        private:
+            friend class ConnPool;
+            Lease(ConnPool* pool, Conn* conn, bool is_writer) :
+                pool(pool), conn(conn), is_writer(is_writer) {};
+
+            ConnPool* pool = nullptr;
+            Conn* conn = nullptr;
+            bool is_writer = false;
+        };
+
+        /** Counters describing contention for connections */
+        struct Stats {
+            size_t leases = 0;   /**< Leases successfully handed out */
+            size_t waits = 0;    /**< Leases which had to wait for a connection */
+            size_t timeouts = 0; /**< Lease requests which gave up */
+            std::chrono::nanoseconds total_wait =
+                std::chrono::nanoseconds(0); /**< Time spent waiting for leases */
+            std::chrono::nanoseconds max_wait =
+                std::chrono::nanoseconds(0); /**< Longest single wait */
+            size_t readers_in_use = 0;
+            bool writer_in_use = false;
+        };
+
+        ConnPool(const std::string& db_name, const PoolOptions& options = PoolOptions());
+        ConnPool(const ConnPool&) = delete;
+        ConnPool& operator=(const ConnPool&) = delete;
+
+        Lease reader();
+        Lease reader(std::chrono::milliseconds timeout);
+        Lease writer();
+        Lease writer(std::chrono::milliseconds timeout);
+        Stats get_stats();
+
+    private:
+        void give_back(Conn* conn, bool is_writer) noexcept;
+        void record_wait(std::chrono::steady_clock::time_point start, bool waited);
+
+        PoolOptions options;
+        std::mutex mutex;
+        std::condition_variable reader_available;
+        std::condition_variable writer_available;
+        std::vector<std::unique_ptr<Conn>> readers;
+        std::vector<Conn*> idle_readers;
+        std::unique_ptr<Conn> writer_conn;
+        bool writer_busy = false;
+        Stats stats;
+    };
+}
@@ -0,0 +1,280 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include "sqlite_profile.h"
+
+namespace SQLite {
+    namespace {
+        /** Stop caching statements past this many, in case the same
+         *  addresses are never seen again
+         */
+        const size_t MAX_SEEN = 4096;
+
+        bool is_identifier(char ch) {
+            return isalnum((unsigned char)ch) || ch == '_' || ch == '$' || (ch & 0x80);
+        }
+
+        void append_json_string(std::string& out, const std::string& str) {
+            out += '"';
+            for (char ch : str) {
+                switch (ch) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if ((unsigned char)ch < 0x20) {
+                        char buffer[8];
+                        snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+                        out += buffer;
+                    }
+                    else {
+                        out += ch;
+                    }
+                }
+            }
+            out += '"';
+        }
+
+        void append_histogram(std::string& out, const Histogram& hist) {
+            out += "{\"count\":" + std::to_string(hist.count) +
+                ",\"sum\":" + std::to_string(hist.sum) +
+                ",\"min\":" + std::to_string(hist.count ? hist.min : 0) +
+                ",\"max\":" + std::to_string(hist.max) +
+                ",\"p50\":" + std::to_string(hist.percentile(0.5)) +
+                ",\"p99\":" + std::to_string(hist.percentile(0.99)) +
+                ",\"buckets\":[";
+
+            // Trailing empty buckets are left out
+            size_t last = Histogram::BUCKETS;
+            while (last > 0 && !hist.buckets[last - 1]) last--;
+            for (size_t i = 0; i < last; i++)
+                out += (i ? "," : "") + std::to_string(hist.buckets[i]);
+            out += "]}";
+        }
+    }
+
+    //
+    // Histogram
+    //
+
+    void Histogram::record(uint64_t value) {
+        size_t bucket = 0;
+        for (uint64_t v = value; v; v >>= 1) bucket++;
+
+        this->buckets[bucket]++;
+        this->count++;
+        this->sum += value;
+        this->min = std::min(this->min, value);
+        this->max = std::max(this->max, value);
+    }
+
+    uint64_t Histogram::percentile(double p) const {
+        /** Return an upper bound for the value below which p (between 0
+         *  and 1) of the recorded values fall
+         */
+        if (!this->count) return 0;
+
+        uint64_t rank = (uint64_t)(p * this->count);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            seen += this->buckets[i];
+            if (seen > rank) {
+                uint64_t upper = (i == 0) ? 0 : (i >= 64 ? UINT64_MAX : ((uint64_t)1 << i) - 1);
+                return std::min(upper, this->max);
+            }
+        }
+
+        return this->max;
+    }
+
+    //
+    // Profiler
+    //
+
+    Profiler::Profiler(Conn& conn) : conn(conn.base) {
+        /** Start profiling every statement run on conn */
+        sqlite3_trace_v2(conn.get_ptr(), SQLITE_TRACE_PROFILE, &Profiler::trace, this);
+    }
+
+    void Profiler::detach() noexcept {
+        /** Stop profiling. Collected profiles remain available. */
+        auto db_base = this->conn.lock();
+        if (db_base && db_base->db)
+            sqlite3_trace_v2(db_base->db, 0, nullptr, nullptr);
+        this->conn.reset();
+    }
+
+    void Profiler::reset() {
+        /** Discard everything collected so far */
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->profiles.clear();
+        this->seen.clear();
+    }
+
+    std::vector<StatementProfile> Profiler::get_profiles() const {
+        /** Return a snapshot of every profile, slowest total time first */
+        std::vector<StatementProfile> ret;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            for (auto& entry : this->profiles)
+                ret.push_back(entry.second);
+        }
+
+        std::sort(ret.begin(), ret.end(),
+            [](const StatementProfile& a, const StatementProfile& b) {
+                return a.time_ns.sum > b.time_ns.sum;
+            });
+        return ret;
+    }
+
+    std::string Profiler::to_json() const {
+        /** Return every profile as a JSON array, slowest total time first */
+        std::string out = "[";
+        bool first = true;
+        for (auto& profile : this->get_profiles()) {
+            out += first ? "\n" : ",\n";
+            first = false;
+
+            out += "{\"sql\":";
+            append_json_string(out, profile.sql);
+            out += ",\"time_ns\":";
+            append_histogram(out, profile.time_ns);
+            out += ",\"vm_steps\":";
+            append_histogram(out, profile.vm_steps);
+            out += ",\"fullscan_steps\":" + std::to_string(profile.fullscan_steps) +
+                ",\"fullscan_runs\":" + std::to_string(profile.fullscan_runs) +
+                ",\"sorts\":" + std::to_string(profile.sorts) +
+                ",\"autoindexes\":" + std::to_string(profile.autoindexes) +
+                ",\"reprepares\":" + std::to_string(profile.reprepares) + "}";
+        }
+
+        return out + "\n]";
+    }
+
+    std::string Profiler::normalize(const char* sql) {
+        /** Replace literals with `?`, strip comments, and collapse runs of
+         *  whitespace, so statements differing only in their values compare
+         *  equal
+         */
+        std::string out;
+        bool space = false; // Whitespace is pending
+
+        auto emit = [&out, &space](const char* begin, size_t size) {
+            if (space && !out.empty()) out += ' ';
+            space = false;
+            out.append(begin, size);
+        };
+
+        const char* ch = sql;
+        while (*ch) {
+            if (isspace((unsigned char)*ch)) {
+                space = true;
+                ch++;
+            }
+            else if (ch[0] == '-' && ch[1] == '-') {
+                while (*ch && *ch != '\n') ch++;
+                space = true;
+            }
+            else if (ch[0] == '/' && ch[1] == '*') {
+                const char* end = strstr(ch + 2, "*/");
+                ch = end ? end + 2 : ch + strlen(ch);
+                space = true;
+            }
+            else if (*ch == '\'' || ((*ch == 'x' || *ch == 'X') && ch[1] == '\'' &&
+                    (ch == sql || !is_identifier(ch[-1])))) {
+                // String or blob literal, with '' escapes
+                if (*ch != '\'') ch++;
+                for (ch++; *ch; ch++) {
+                    if (*ch == '\'') {
+                        if (ch[1] == '\'') ch++;
+                        else break;
+                    }
+                }
+
+                if (*ch) ch++;
+                emit("?", 1);
+            }
+            else if (*ch == '?') {
+                // Numbered parameter
+                for (ch++; isdigit((unsigned char)*ch); ch++);
+                emit("?", 1);
+            }
+            else if (*ch == '"' || *ch == '`' || *ch == '[') {
+                // Quoted identifier, kept as is
+                char close = (*ch == '[') ? ']' : *ch;
+                const char* start = ch;
+                for (ch++; *ch && *ch != close; ch++);
+                if (*ch) ch++;
+                emit(start, ch - start);
+            }
+            else if (isdigit((unsigned char)*ch) ||
+                    (*ch == '.' && isdigit((unsigned char)ch[1]))) {
+                // Numeric literal, including hex and exponents
+                while (is_identifier(*ch) || *ch == '.' ||
+                    ((*ch == '+' || *ch == '-') && (ch[-1] == 'e' || ch[-1] == 'E')))
+                    ch++;
+                emit("?", 1);
+            }
+            else if (is_identifier(*ch)) {
+                const char* start = ch;
+                while (is_identifier(*ch)) ch++;
+                emit(start, ch - start);
+            }
+            else {
+                emit(ch, 1);
+                ch++;
+            }
+        }
+
+        return out;
+    }
+
+    int Profiler::trace(unsigned type, void* context, void* p, void* x) {
+        /** sqlite3_trace_v2() callback, called when a statement finishes */
+        if (type == SQLITE_TRACE_PROFILE)
+            ((Profiler*)context)->record((sqlite3_stmt*)p, *(sqlite3_int64*)x);
+        return 0;
+    }
+
+    StatementProfile& Profiler::lookup(sqlite3_stmt* stmt) {
+        /** Find the profile for a statement. Must be called with the mutex held. */
+        const char* raw = sqlite3_sql(stmt);
+        if (!raw) raw = "";
+
+        auto it = this->seen.find(stmt);
+        if (it != this->seen.end() && it->second.raw == raw)
+            return *it->second.profile;
+
+        std::string sql = normalize(raw);
+        StatementProfile& profile = this->profiles[sql];
+        if (profile.sql.empty()) profile.sql = sql;
+
+        if (this->seen.size() >= MAX_SEEN) this->seen.clear();
+        this->seen[stmt] = Seen{ raw, &profile };
+        return profile;
+    }
+
+    void Profiler::record(sqlite3_stmt* stmt, uint64_t ns) {
+        // Counters are reset after each run, so they cover just this run
+        uint64_t fullscan = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+        uint64_t sorts = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 1);
+        uint64_t autoindex = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+        uint64_t vm_steps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 1);
+        uint64_t reprepare = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_REPREPARE, 1);
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        StatementProfile& profile = this->lookup(stmt);
+        profile.time_ns.record(ns);
+        profile.vm_steps.record(vm_steps);
+        profile.fullscan_steps += fullscan;
+        profile.sorts += sorts;
+        profile.autoindexes += autoindex;
+        profile.reprepares += reprepare;
+        if (fullscan) profile.fullscan_runs++;
+    }
+}
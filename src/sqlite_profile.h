@@ -0,0 +1,98 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+/** @file
+ *  Per-statement profiling using sqlite3_trace_v2() and sqlite3_stmt_status()
+ */
+
+#pragma once
+#include <stdint.h>
+#include <mutex>
+#include "sqlite_cpp.h"
+
+namespace SQLite {
+    /** A histogram with power of two buckets: bucket i counts values in
+     *  [2^(i-1), 2^i), and bucket 0 counts zeroes
+     */
+    struct Histogram {
+        static const size_t BUCKETS = 65;
+
+        uint64_t buckets[BUCKETS] = {};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = UINT64_MAX;
+        uint64_t max = 0;
+
+        void record(uint64_t value);
+        double mean() const { return this->count ? (double)this->sum / this->count : 0; }
+        uint64_t percentile(double p) const;
+    };
+
+    /** Aggregated measurements for every statement with the same
+     *  normalized SQL text
+     */
+    struct StatementProfile {
+        std::string sql;         /**< Normalized SQL, see Profiler::normalize() */
+        Histogram time_ns;       /**< Wall clock time per run */
+        Histogram vm_steps;      /**< Virtual machine operations per run */
+        uint64_t fullscan_steps = 0; /**< Steps through full table scans */
+        uint64_t sorts = 0;          /**< Sort operations */
+        uint64_t autoindexes = 0;    /**< Rows inserted into automatic indices */
+        uint64_t reprepares = 0;     /**< Times recompiled after a schema change */
+        uint64_t fullscan_runs = 0;  /**< Runs which did any full scan steps */
+    };
+
+    /** An opt-in profiler which records every statement run on a connection,
+     *  including those run by Conn::exec()
+     *
+     *  Statements are grouped by SQL text with literals replaced by `?`, so
+     *  `SELECT * FROM t WHERE id = 1` and `... id = 2` are counted together.
+     *  Measurements can be read at any time, from any thread.
+     *
+     *  **Example**
+     *  ```
+     *  SQLite::Profiler profiler(db);
+     *  // ...run queries...
+     *  for (auto& profile : profiler.get_profiles()) {
+     *      if (profile.fullscan_steps)
+     *          std::cout << profile.sql << " does full table scans" << std::endl;
+     *  }
+     *  ```
+     *
+     *  #### Memory Safety
+     *  The profiler must be destroyed or detach()'ed before its Conn is
+     *  destroyed. Only one profiler may be attached to a connection.
+     */
+    class Profiler {
+    public:
+        Profiler(Conn& conn);
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+        ~Profiler() { this->detach(); }
+
+        void detach() noexcept;
+        void reset();
+        std::vector<StatementProfile> get_profiles() const;
+        std::string to_json() const;
+
+        static std::string normalize(const char* sql);
+
+    private:
+        static int trace(unsigned type, void* context, void* p, void* x);
+        void record(sqlite3_stmt* stmt, uint64_t ns);
+        StatementProfile& lookup(sqlite3_stmt* stmt);
+
+        std::weak_ptr<conn_base> conn;
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, StatementProfile> profiles; /**< By normalized SQL */
+
+        /** Statements seen recently, so normalize() isn't run on every step */
+        struct Seen {
+            std::string raw;
+            StatementProfile* profile;
+        };
+        std::unordered_map<sqlite3_stmt*, Seen> seen;
+    };
+}
@@ -0,0 +1,439 @@
+/*
+SQLite for C++ (https://github.com/vincentlaucsb/sqlite-cpp/)
+Copyright(c) 2017-2018 Vincent La and released under the MIT License.
+*/
+
+/** @file
+ *  Virtual tables for querying C++ containers in place
+ */
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include "sqlite_cpp.h"
+
+namespace SQLite {
+    /** A view of a contiguous array, e.g. fixed size records in a memory
+     *  mapped file, which can be passed to create_virtual_table()
+     */
+    template<typename T>
+    struct ArrayView {
+        const T* data = nullptr;
+        size_t size = 0;
+
+        const T* begin() const { return this->data; }
+        const T* end() const { return this->data + this->size; }
+    };
+
+    /** Describes the columns of a virtual table whose rows are Rows
+     *
+     *  Each column is read from a row by a member pointer or a function
+     *  returning any type Conn::create_function() can return. One column
+     *  may be declared the key, which the rows must be sorted by in
+     *  ascending order. Constraints on the key (=, <, <=, >, >=) are then
+     *  answered by binary search instead of a full scan.
+     *
+     *  **Example**
+     *  ```
+     *  struct Player {
+     *      long long int id;
+     *      std::string name;
+     *  };
+     *
+     *  SQLite::VirtualTableSpec<Player> spec;
+     *  spec.key("id", &Player::id).column("name", &Player::name);
+     *  ```
+     */
+    template<typename Row>
+    class VirtualTableSpec {
+    public:
+        /** One column, with its accessor wrapped up */
+        struct Column {
+            std::string name;
+            std::string type; /**< Declared type, giving the column its affinity */
+            std::function<void(sqlite3_context*, const Row&)> result;
+
+            /** Compare a row's value to a constraint's, or leave the
+             *  result unset if they can't be compared directly. Only set
+             *  for the key.
+             */
+            std::function<bool(const Row&, sqlite3_value*, int&)> compare;
+
+            /** Compared byte by byte, so constraints using another
+             *  collation, such as NOCASE, can't narrow down the rows
+             */
+            bool binary_only = false;
+        };
+
+        template<typename F>
+        VirtualTableSpec& column(const std::string& name, F accessor) {
+            /** Add a column read from each row by accessor, which is either
+             *  a member pointer or a function taking `const Row&`
+             */
+            auto get = make_getter(accessor);
+            using T = typename std::decay<decltype(get(std::declval<const Row&>()))>::type;
+
+            Column col;
+            col.name = name;
+            col.type = declared_type<T>();
+            col.result = [get](sqlite3_context* context, const Row& row) {
+                result_value(context, get(row));
+            };
+            this->columns.push_back(std::move(col));
+            return *this;
+        }
+
+        template<typename F>
+        VirtualTableSpec& key(const std::string& name, F accessor) {
+            /** Add the column which the rows are sorted by */
+            auto get = make_getter(accessor);
+            using T = typename std::decay<decltype(get(std::declval<const Row&>()))>::type;
+
+            this->column(name, accessor);
+            this->key_column = (int)this->columns.size() - 1;
+            this->columns.back().compare = [get](const Row& row, sqlite3_value* value, int& cmp) {
+                return compare_value<T>(get(row), value, cmp);
+            };
+            this->columns.back().binary_only =
+                !std::is_arithmetic<T>::value && std::is_convertible<const T&, std::string_view>::value;
+            return *this;
+        }
+
+        std::vector<Column> columns;
+        int key_column = -1; /**< Index of the sorted column, or -1 */
+
+    private:
+        template<typename T, typename C>
+        static auto make_getter(T C::* member) {
+            return [member](const Row& row) -> const T& { return row.*member; };
+        }
+
+        template<typename F>
+        static F make_getter(F func) { return func; }
+
+        template<typename T>
+        static std::string declared_type() {
+            if constexpr (is_optional<T>::value)
+                return declared_type<typename T::value_type>();
+            else if constexpr (std::is_integral<T>::value)
+                return "INTEGER";
+            else if constexpr (std::is_floating_point<T>::value)
+                return "REAL";
+            else if constexpr (std::is_same<T, Blob>::value || std::is_same<T, BlobView>::value)
+                return "BLOB";
+            else
+                return "TEXT";
+        }
+
+        template<typename T>
+        static bool compare_value(const T& key, sqlite3_value* value, int& cmp) {
+            if constexpr (std::is_arithmetic<T>::value) {
+                // Applies numeric affinity, so '28' is compared as 28
+                int type = sqlite3_value_numeric_type(value);
+                if (type == SQLITE_INTEGER && std::is_integral<T>::value) {
+                    auto other = sqlite3_value_int64(value);
+                    cmp = ((long long int)key > other) - ((long long int)key < other);
+                    return true;
+                }
+                else if (type == SQLITE_INTEGER || type == SQLITE_FLOAT) {
+                    double other = sqlite3_value_double(value);
+                    if (std::isnan(other)) return false;
+                    cmp = ((double)key > other) - ((double)key < other);
+                    return true;
+                }
+
+                return false;
+            }
+            else if constexpr (std::is_convertible<const T&, std::string_view>::value) {
+                if (sqlite3_value_type(value) != SQLITE_TEXT) return false;
+                auto text = (const char*)sqlite3_value_text(value);
+                std::string_view other(text ? text : "", (size_t)sqlite3_value_bytes(value));
+                int result = std::string_view(key).compare(other);
+                cmp = (result > 0) - (result < 0);
+                return true;
+            }
+            else {
+                return false; // Always scanned in full
+            }
+        }
+    };
+
+    /** The sqlite3_module implementation behind create_virtual_table() */
+    template<typename Range>
+    class VirtualTable {
+    public:
+        using Iterator = decltype(std::begin(std::declval<const Range&>()));
+        using Row = typename std::iterator_traits<Iterator>::value_type;
+
+        VirtualTable(const Range& range, VirtualTableSpec<Row> spec) :
+            range(range), spec(std::move(spec)) {};
+
+        static sqlite3_module* get_module() {
+            static sqlite3_module module = make_module();
+            return &module;
+        }
+
+    private:
+        /** Flags in idxNum describing which constraints were passed to
+         *  xFilter(), in this order
+         */
+        enum Plan {
+            KEY_EQ = 1, KEY_GT = 2, KEY_GE = 4, KEY_LT = 8, KEY_LE = 16
+        };
+
+        struct Table : sqlite3_vtab {
+            VirtualTable* owner;
+        };
+
+        struct Cursor : sqlite3_vtab_cursor {
+            Iterator begin;
+            size_t pos = 0;
+            size_t end = 0;
+        };
+
+        static sqlite3_module make_module() {
+            sqlite3_module module;
+            memset(&module, 0, sizeof(module));
+            module.iVersion = 1;
+            module.xCreate = nullptr; // Eponymous only: no CREATE VIRTUAL TABLE needed
+            module.xConnect = &VirtualTable::connect;
+            module.xBestIndex = &VirtualTable::best_index;
+            module.xDisconnect = &VirtualTable::disconnect;
+            module.xOpen = &VirtualTable::open;
+            module.xClose = &VirtualTable::close;
+            module.xFilter = &VirtualTable::filter;
+            module.xNext = &VirtualTable::next;
+            module.xEof = &VirtualTable::eof;
+            module.xColumn = &VirtualTable::column;
+            module.xRowid = &VirtualTable::rowid;
+            return module;
+        }
+
+        size_t size() const {
+            return (size_t)std::distance(std::begin(this->range), std::end(this->range));
+        }
+
+        static int connect(sqlite3* db, void* data, int, const char* const*,
+            sqlite3_vtab** out, char**) {
+            auto owner = (VirtualTable*)data;
+            std::string schema = "CREATE TABLE x(";
+            for (size_t i = 0; i < owner->spec.columns.size(); i++) {
+                auto& col = owner->spec.columns[i];
+                schema += (i ? ", \"" : "\"") + col.name + "\" " + col.type;
+            }
+            schema += ")";
+
+            int result = sqlite3_declare_vtab(db, schema.c_str());
+            if (result != SQLITE_OK) return result;
+
+            Table* table = new (std::nothrow) Table();
+            if (!table) return SQLITE_NOMEM;
+            table->owner = owner;
+            *out = table;
+            return SQLITE_OK;
+        }
+
+        static int disconnect(sqlite3_vtab* table) {
+            delete (Table*)table;
+            return SQLITE_OK;
+        }
+
+        static int best_index(sqlite3_vtab* vtab, sqlite3_index_info* info) {
+            /** Use at most one equality, lower bound, and upper bound on
+             *  the key. SQLite still checks each constraint itself, so they
+             *  only have to narrow down the rows.
+             */
+            auto owner = ((Table*)vtab)->owner;
+            int key = owner->spec.key_column;
+            int eq = -1, lower = -1, upper = -1;
+            int plan = 0;
+
+            for (int i = 0; key >= 0 && i < info->nConstraint; i++) {
+                auto& constraint = info->aConstraint[i];
+                if (!constraint.usable || constraint.iColumn != key) continue;
+                if (owner->spec.columns[key].binary_only && !is_binary(info, i)) continue;
+
+                switch (constraint.op) {
+                case SQLITE_INDEX_CONSTRAINT_EQ:
+                    if (eq < 0) { eq = i; plan |= KEY_EQ; }
+                    break;
+                case SQLITE_INDEX_CONSTRAINT_GT:
+                case SQLITE_INDEX_CONSTRAINT_GE:
+                    if (lower < 0) {
+                        lower = i;
+                        plan |= (constraint.op == SQLITE_INDEX_CONSTRAINT_GT) ? KEY_GT : KEY_GE;
+                    }
+                    break;
+                case SQLITE_INDEX_CONSTRAINT_LT:
+                case SQLITE_INDEX_CONSTRAINT_LE:
+                    if (upper < 0) {
+                        upper = i;
+                        plan |= (constraint.op == SQLITE_INDEX_CONSTRAINT_LT) ? KEY_LT : KEY_LE;
+                    }
+                    break;
+                }
+            }
+
+            int argv_index = 1;
+            for (int i : { eq, lower, upper }) {
+                if (i >= 0) info->aConstraintUsage[i].argvIndex = argv_index++;
+            }
+
+            double rows = (double)owner->size();
+            double log_rows = std::log2(rows + 1) + 1;
+            if (plan & KEY_EQ) rows = 1;
+            else if (lower >= 0 && upper >= 0) rows = rows / 16 + 1;
+            else if (lower >= 0 || upper >= 0) rows = rows / 4 + 1;
+
+            info->idxNum = plan;
+            info->estimatedRows = (sqlite3_int64)rows;
+            info->estimatedCost = plan ? log_rows + rows : rows;
+
+            // Rows come out sorted by the key
+            if (key >= 0 && info->nOrderBy == 1 && info->aOrderBy[0].iColumn == key &&
+                !info->aOrderBy[0].desc)
+                info->orderByConsumed = 1;
+
+            return SQLITE_OK;
+        }
+
+        static bool is_binary(sqlite3_index_info* info, int i) {
+            /** Whether constraint i compares text with the BINARY collation.
+             *  Before SQLite 3.22 the collation is unknown, so assume not.
+             */
+#if SQLITE_VERSION_NUMBER >= 3022000
+            const char* collation = sqlite3_vtab_collation(info, i);
+            return !collation || sqlite3_stricmp(collation, "BINARY") == 0;
+#else
+            (void)info; (void)i;
+            return false;
+#endif
+        }
+
+        static int open(sqlite3_vtab*, sqlite3_vtab_cursor** out) {
+            Cursor* cursor = new (std::nothrow) Cursor();
+            if (!cursor) return SQLITE_NOMEM;
+            *out = cursor;
+            return SQLITE_OK;
+        }
+
+        static int close(sqlite3_vtab_cursor* cursor) {
+            delete (Cursor*)cursor;
+            return SQLITE_OK;
+        }
+
+        static int filter(sqlite3_vtab_cursor* base, int plan, const char*,
+            int, sqlite3_value** argv) {
+            /** Narrow the cursor down to the rows matching the key
+             *  constraints chosen by best_index()
+             */
+            Cursor* cursor = (Cursor*)base;
+            auto owner = ((Table*)base->pVtab)->owner;
+            cursor->begin = std::begin(owner->range);
+            cursor->pos = 0;
+            cursor->end = owner->size();
+            if (!plan) return SQLITE_OK;
+
+            auto& compare = owner->spec.columns[owner->spec.key_column].compare;
+            const auto begin = cursor->begin, end = cursor->begin + cursor->end;
+            auto first = begin, last = end;
+            sqlite3_value** arg = argv;
+
+            // The first row above value, or if skip_equal is false, the first
+            // row not below it. Values which can't be compared to the key,
+            // such as text for a numeric key, don't narrow anything.
+            auto bound = [&](sqlite3_value* value, bool skip_equal, Iterator fallback) {
+                int cmp;
+                if (begin == end || !compare(*begin, value, cmp)) return fallback;
+                return std::partition_point(begin, end, [&](const Row& row) {
+                    compare(row, value, cmp);
+                    return skip_equal ? cmp <= 0 : cmp < 0;
+                });
+            };
+
+            if (plan & KEY_EQ) {
+                sqlite3_value* value = *arg++;
+                first = bound(value, false, begin);
+                last = bound(value, true, end);
+            }
+
+            if (plan & (KEY_GT | KEY_GE))
+                first = std::max(first, bound(*arg++, plan & KEY_GT, begin));
+
+            if (plan & (KEY_LT | KEY_LE))
+                last = std::min(last, bound(*arg++, plan & KEY_LE, end));
+
+            if (first > last) first = last;
+            cursor->pos = (size_t)(first - cursor->begin);
+            cursor->end = (size_t)(last - cursor->begin);
+            return SQLITE_OK;
+        }
+
+        static int next(sqlite3_vtab_cursor* cursor) {
+            ((Cursor*)cursor)->pos++;
+            return SQLITE_OK;
+        }
+
+        static int eof(sqlite3_vtab_cursor* cursor) {
+            return ((Cursor*)cursor)->pos >= ((Cursor*)cursor)->end;
+        }
+
+        static int column(sqlite3_vtab_cursor* base, sqlite3_context* context, int i) {
+            Cursor* cursor = (Cursor*)base;
+            auto owner = ((Table*)base->pVtab)->owner;
+            try {
+                owner->spec.columns[i].result(context, *(cursor->begin + cursor->pos));
+            }
+            catch (...) {
+                result_exception(context);
+            }
+
+            return SQLITE_OK;
+        }
+
+        static int rowid(sqlite3_vtab_cursor* cursor, sqlite3_int64* out) {
+            *out = (sqlite3_int64)((Cursor*)cursor)->pos;
+            return SQLITE_OK;
+        }
+
+        const Range& range;
+        VirtualTableSpec<Row> spec;
+    };
+
+    template<typename Range, typename Row>
+    void create_virtual_table(Conn& db, const std::string& name, const Range& range,
+        VirtualTableSpec<Row> spec) {
+        /** Expose the rows of a random access range, such as a std::vector
+         *  or an ArrayView, as a read-only table without copying them
+         *
+         *  The table can be queried as soon as this returns. It only exists
+         *  on this connection.
+         *
+         *  **Example**
+         *  ```
+         *  std::vector<Player> players = ...; // Sorted by id
+         *  SQLite::VirtualTableSpec<Player> spec;
+         *  spec.key("id", &Player::id).column("name", &Player::name);
+         *  SQLite::create_virtual_table(db, "players", players, spec);
+         *
+         *  // Binary search, not a full scan
+         *  db.query("SELECT name FROM players WHERE id BETWEEN 10 AND 20");
+         *  ```
+         *
+         *  #### Memory Safety
+         *  range must outlive the connection, and must not be modified
+         *  while a query on it is running.
+         */
+        using Table = VirtualTable<Range>;
+        static_assert(std::is_same<typename Table::Row, Row>::value,
+            "The spec must describe the range's element type");
+
+        // SQLite calls xDestroy if registering fails, or once the module is
+        // replaced or the connection is closed
+        int result = sqlite3_create_module_v2(db.get_ptr(), name.c_str(), Table::get_module(),
+            new Table(range, std::move(spec)), [](void* table) { delete (Table*)table; });
+        if (result != SQLITE_OK)
+            throw SQLiteError(sqlite3_errmsg(db.get_ptr()));
+    }
+}
@@ -188,4 +188,145 @@ TEST_CASE("Empty Query Test", "[test_no_results]") {
     db.close();
     REQUIRE(i == 0);
     REQUIRE(remove("database.sqlite") == 0);
-}
\ No newline at end of file
+}
+
+/** Test that SQLField reuses its storage and checks types */
+TEST_CASE("SQLField In-Place Test", "[test_sqlfield]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int, Rating real, Photo blob)");
+    db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28, 102.8, x'CAFE')");
+    db.exec("INSERT INTO dillydilly VALUES (NULL, 'Tom Brady', NULL, 28)");
+
+    auto results = db.query("SELECT * FROM dillydilly");
+    std::vector<SQLField> row;
+
+    REQUIRE(results.next(row));
+    REQUIRE(row.size() == 4);
+    REQUIRE(row[0].get<std::string_view>() == "Tom Brady");
+    REQUIRE(row[2].type() == SQLITE_FLOAT);
+    REQUIRE(row[2].get<double>() == 102.8);
+    REQUIRE(row[3].type() == SQLITE_BLOB);
+    REQUIRE(row[3].get<BlobView>().size == 2);
+    REQUIRE(row[3].get<BlobView>().data[0] == 0xCA);
+
+    // Same vector, different types in each column
+    REQUIRE(results.next(row));
+    REQUIRE(row[0].type() == SQLITE_NULL);
+    REQUIRE(row[1].get<std::string>() == "Tom Brady");
+    REQUIRE(row[2].type() == SQLITE_NULL);
+    REQUIRE(row[3].get<long long int>() == 28);
+
+    bool error_thrown = false;
+    try {
+        row[1].get<double>();
+    }
+    catch (SQLite::ValueError&) {
+        error_thrown = true;
+    }
+
+    REQUIRE(error_thrown);
+    REQUIRE(SQLField("Touchdown").get<std::string>() == "Touchdown");
+    REQUIRE(SQLField(7).get<long long int>() == 7);
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test that RowView reads values in place */
+TEST_CASE("RowView Test", "[test_row_view]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int, Rating real)");
+    db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28, 102.8)");
+    db.exec("INSERT INTO dillydilly VALUES (NULL, NULL, NULL)");
+
+    auto results = db.query("SELECT * FROM dillydilly");
+    SQLite::RowView row;
+    int i = 0;
+
+    while (results.next(row)) {
+        REQUIRE(row.size() == 3);
+
+        switch (i) {
+        case 0:
+            REQUIRE(row[0].type() == SQLITE_TEXT);
+            REQUIRE(row[0].get<std::string_view>() == "Tom Brady");
+            REQUIRE(row[1].get<long long int>() == 28);
+            REQUIRE(row[2].get<double>() == 102.8);
+            break;
+        case 1:
+            REQUIRE(row[0].is_null());
+            REQUIRE(row[0].get<std::string_view>().empty());
+            REQUIRE(row[1].get<int>() == 0);
+            break;
+        }
+
+        i++;
+    }
+
+    REQUIRE(i == 2);
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test fetching results column by column */
+TEST_CASE("Column Batch Test", "[test_next_batch]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int, Rating real)");
+    db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28, 102.8)");
+    db.exec("INSERT INTO dillydilly VALUES (NULL, 26, NULL)");
+    db.exec("INSERT INTO dillydilly VALUES ('Drew Brees', NULL, 103.9)");
+
+    auto results = db.query("SELECT Player, Touchdown, Rating, Touchdown * 2 FROM dillydilly");
+    SQLite::ColumnBatch batch;
+
+    REQUIRE(results.next_batch(batch, 2) == 2);
+    REQUIRE(batch.names == std::vector<std::string>({ "Player", "Touchdown", "Rating",
+        "Touchdown * 2" }));
+    REQUIRE(batch.columns[0].type == SQLITE_TEXT);
+    REQUIRE(batch.columns[0].get<std::string_view>(0) == "Tom Brady");
+    REQUIRE(batch.columns[0].is_null(1));
+    REQUIRE(batch.columns[0].null_count == 1);
+    REQUIRE(batch.columns[1].ints == std::vector<long long int>({ 28, 26 }));
+    REQUIRE(batch.columns[2].get<double>(0) == 102.8);
+    REQUIRE(batch.columns[3].type == SQLITE_INTEGER);
+
+    REQUIRE(results.next_batch(batch, 2) == 1);
+    REQUIRE(batch.columns[0].get<std::string_view>(0) == "Drew Brees");
+    REQUIRE(batch.columns[1].is_null(0));
+    REQUIRE(batch.columns[3].type == SQLITE_NULL); // Expression was always NULL
+
+    REQUIRE(results.next_batch(batch, 2) == 0);
+    REQUIRE(results.next_batch(batch, 2) == 0);
+
+    SECTION("Mixed Types") {
+        db.exec("CREATE TABLE mixed (x INT)");
+        db.exec("INSERT INTO mixed VALUES (1), (NULL), (2.5), ('abc'), (x'00ff')");
+        results = db.query("SELECT x FROM mixed");
+
+        // Values wider than the declared type widen the column
+        REQUIRE(results.next_batch(batch, 3) == 3);
+        REQUIRE(batch.columns[0].type == SQLITE_FLOAT);
+        REQUIRE(batch.columns[0].reals.size() == 3);
+        REQUIRE(batch.columns[0].get<double>(0) == 1);
+        REQUIRE(batch.columns[0].is_null(1));
+        REQUIRE(batch.columns[0].get<double>(2) == 2.5);
+
+        REQUIRE(results.next_batch(batch, 2) == 2);
+        REQUIRE(batch.columns[0].type == SQLITE_BLOB);
+        REQUIRE(batch.columns[0].null_count == 0);
+        REQUIRE(batch.columns[0].get<std::string_view>(0) == "abc");
+        REQUIRE(batch.columns[0].get<std::string_view>(1) == std::string_view("\0\xff", 2));
+
+        results = db.query("SELECT x FROM mixed");
+        REQUIRE(results.next_batch(batch, 4) == 4);
+        REQUIRE(batch.columns[0].type == SQLITE_TEXT);
+        REQUIRE(batch.columns[0].get<std::string_view>(0) == "1.0"); // Widened through FLOAT
+        REQUIRE(batch.columns[0].is_null(1));
+        REQUIRE(batch.columns[0].get<std::string_view>(1) == "");
+        REQUIRE(batch.columns[0].get<std::string_view>(2) == "2.5");
+        REQUIRE(batch.columns[0].get<std::string_view>(3) == "abc");
+    }
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
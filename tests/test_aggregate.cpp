@@ -0,0 +1,184 @@
+#include "catch.hpp"
+#include "sqlite_cpp.h"
+
+using namespace SQLite;
+
+namespace {
+    /** Usable as a window function, or a plain aggregate before SQLite 3.25 */
+    struct Mean {
+        double sum = 0;
+        long long int count = 0;
+
+        void step(double x) { sum += x; count++; }
+        void inverse(double x) { sum -= x; count--; }
+        std::optional<double> result() {
+            if (!count) return std::nullopt;
+            return sum / count;
+        }
+    };
+
+    /** Joins strings, to check state with a non-trivial destructor */
+    struct Join {
+        static int live;
+        std::string out;
+
+        Join() { live++; }
+        ~Join() { live--; }
+
+        void step(std::string_view str, std::string_view sep) {
+            if (!out.empty()) out += sep;
+            out += str;
+        }
+
+        const std::string& result() {
+            if (out == "Error") throw ValueError("Refusing to join");
+            return out;
+        }
+    };
+
+    int Join::live = 0;
+
+    /** Over-aligned state, which must still be placed correctly */
+    struct alignas(64) Count {
+        long long int n = 0;
+
+        void step(long long int) {
+            if ((uintptr_t)this % 64) throw ValueError("Misaligned");
+            n++;
+        }
+
+        long long int result() { return n; }
+    };
+}
+
+/** Test registering C++ classes as aggregate functions */
+TEST_CASE("User Defined Aggregate Test", "[test_aggregate]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Team TEXT, Touchdown int)");
+    db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 'Patriots', 28)");
+    db.exec("INSERT INTO dillydilly VALUES ('Jimmy Garoppolo', 'Patriots', 0)");
+    db.exec("INSERT INTO dillydilly VALUES ('Drew Brees', 'Saints', 21)");
+
+    db.create_aggregate<Mean>("mean", true);
+    db.create_aggregate<Join>("join_str");
+
+    SECTION("Groups") {
+        auto results = db.query("SELECT Team, mean(Touchdown), join_str(Player, ', ') "
+            "FROM dillydilly GROUP BY Team ORDER BY Team");
+        RowView row;
+        REQUIRE(results.next(row));
+        REQUIRE(row[1].get<double>() == 14);
+        REQUIRE(row[2].get<std::string_view>() == "Tom Brady, Jimmy Garoppolo");
+        REQUIRE(results.next(row));
+        REQUIRE(row[1].get<double>() == 21);
+        REQUIRE(row[2].get<std::string_view>() == "Drew Brees");
+        REQUIRE_FALSE(results.next(row));
+        REQUIRE(Join::live == 0);
+    }
+
+    SECTION("Many Groups") {
+        // Many groups, each with its own state
+        db.exec("CREATE TABLE numbers (x int)");
+        db.exec("WITH RECURSIVE n(x) AS (SELECT 0 UNION ALL SELECT x + 1 FROM n WHERE x < 999) "
+            "INSERT INTO numbers SELECT x FROM n");
+
+        for (int i = 0; i < 2; i++) {
+            auto results = db.query("SELECT x % 200, join_str(x, '+') FROM numbers "
+                "GROUP BY x % 200 ORDER BY x % 200");
+            RowView row;
+            size_t groups = 0;
+            while (results.next(row)) groups++;
+            REQUIRE(groups == 200);
+            REQUIRE(Join::live == 0);
+        }
+    }
+
+    SECTION("Interleaved Queries") {
+        // Each query's groups have their own state
+        db.create_aggregate<Count>("count_aligned");
+        auto first = db.query("SELECT Team, join_str(Player, ','), count_aligned(Touchdown) "
+            "FROM dillydilly GROUP BY Team ORDER BY Team");
+        auto second = db.query("SELECT Team, join_str(Team, ','), count_aligned(Touchdown) "
+            "FROM dillydilly GROUP BY Team ORDER BY Team DESC");
+        RowView a, b;
+        REQUIRE(first.next(a));
+        REQUIRE(second.next(b));
+        REQUIRE(a[1].get<std::string_view>() == "Tom Brady,Jimmy Garoppolo");
+        REQUIRE(a[2].get<long long int>() == 2);
+        REQUIRE(b[1].get<std::string_view>() == "Saints");
+        REQUIRE(b[2].get<long long int>() == 1);
+        REQUIRE(first.next(a));
+        REQUIRE(second.next(b));
+        REQUIRE(a[1].get<std::string_view>() == "Drew Brees");
+        REQUIRE(b[1].get<std::string_view>() == "Patriots,Patriots");
+        first.close();
+        second.close();
+        REQUIRE(Join::live == 0);
+    }
+
+    SECTION("No Rows") {
+        auto results = db.query("SELECT mean(Touchdown), join_str(Player, ',') "
+            "FROM dillydilly WHERE 0");
+        RowView row;
+        REQUIRE(results.next(row));
+        REQUIRE(row[0].is_null());
+        REQUIRE(row[1].get<std::string_view>() == "");
+    }
+
+    SECTION("Errors") {
+        REQUIRE_THROWS_AS(db.exec("SELECT join_str('Error', '')"), SQLiteError);
+        REQUIRE_THROWS_AS(db.exec("SELECT mean()"), SQLiteError);
+        REQUIRE(Join::live == 0);
+    }
+
+    SECTION("Abandoned Query") {
+        {
+            auto results = db.query("SELECT Team, join_str(Player, ',') FROM dillydilly "
+                "GROUP BY Team");
+            RowView row;
+            REQUIRE(results.next(row));
+        }
+
+        REQUIRE(Join::live == 0);
+    }
+
+#if SQLITE_VERSION_NUMBER >= 3025000
+    SECTION("Window Functions") {
+        auto results = db.query("SELECT mean(Touchdown) OVER "
+            "(ORDER BY Touchdown ROWS BETWEEN 1 PRECEDING AND CURRENT ROW) FROM dillydilly");
+        std::vector<double> means;
+        RowView row;
+        while (results.next(row))
+            means.push_back(row[0].get<double>());
+        REQUIRE(means == std::vector<double>({ 0, 10.5, 24.5 }));
+    }
+#endif
+
+    db.close();
+    REQUIRE(Join::live == 0);
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test that aggregate state is recycled, and released once no group is live */
+TEST_CASE("Aggregate Arena Test", "[test_aggregate]") {
+    SQLite::AggregateArena<Count> arena;
+    std::vector<Count*> groups;
+    for (int i = 0; i < 5000; i++)
+        groups.push_back(arena.create());
+    REQUIRE(arena.blocks_held() > 1);
+
+    // Slots are reused while other groups are still live
+    Count* first = groups[0];
+    arena.destroy(first);
+    groups[0] = arena.create();
+    REQUIRE(groups[0] == first);
+    REQUIRE((uintptr_t)groups[0] % 64 == 0);
+
+    // Only the newest block is kept once every group is done
+    for (Count* count : groups) arena.destroy(count);
+    REQUIRE(arena.blocks_held() == 1);
+
+    for (int i = 0; i < 100; i++) groups[i] = arena.create();
+    REQUIRE(arena.blocks_held() == 1);
+    for (int i = 0; i < 100; i++) arena.destroy(groups[i]);
+}
@@ -0,0 +1,69 @@
+#include <string.h>
+#include "catch.hpp"
+#include "sqlite_arrow.h"
+
+using namespace SQLite;
+
+/** Test exporting query results through the Arrow C data interface */
+TEST_CASE("Arrow Export Test", "[test_arrow]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int, Rating real, Photo blob)");
+    db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28, 102.8, x'CAFE')");
+    db.exec("INSERT INTO dillydilly VALUES ('Drew Brees', NULL, 103.9, NULL)");
+
+    auto results = db.query("SELECT *, NULL AS Unknown FROM dillydilly");
+    SQLite::ColumnBatch batch;
+    REQUIRE(results.next_batch(batch, 10) == 2);
+
+    ArrowArray array;
+    ArrowSchema schema;
+    export_arrow(batch, &array, &schema);
+    REQUIRE(batch.rows == 0);
+
+    REQUIRE(strcmp(schema.format, "+s") == 0);
+    REQUIRE(schema.n_children == 5);
+    REQUIRE(array.length == 2);
+    REQUIRE(array.n_children == 5);
+
+    const char* formats[] = { "U", "l", "g", "Z", "n" };
+    const char* names[] = { "Player", "Touchdown", "Rating", "Photo", "Unknown" };
+    for (int i = 0; i < 5; i++) {
+        REQUIRE(strcmp(schema.children[i]->format, formats[i]) == 0);
+        REQUIRE(strcmp(schema.children[i]->name, names[i]) == 0);
+        REQUIRE(schema.children[i]->flags == ARROW_FLAG_NULLABLE);
+    }
+
+    // Text
+    ArrowArray* player = array.children[0];
+    REQUIRE(player->n_buffers == 3);
+    REQUIRE(player->null_count == 0);
+    REQUIRE(player->buffers[0] == nullptr);
+    auto offsets = (const int64_t*)player->buffers[1];
+    auto chars = (const char*)player->buffers[2];
+    REQUIRE(std::string(chars + offsets[1], offsets[2] - offsets[1]) == "Drew Brees");
+
+    // Integers with a NULL
+    ArrowArray* touchdown = array.children[1];
+    REQUIRE(touchdown->null_count == 1);
+    auto validity = (const unsigned char*)touchdown->buffers[0];
+    REQUIRE(validity[0] == 0x01);
+    REQUIRE(((const int64_t*)touchdown->buffers[1])[0] == 28);
+
+    // Floats
+    REQUIRE(((const double*)array.children[2]->buffers[1])[1] == 103.9);
+
+    // Null type
+    REQUIRE(array.children[4]->n_buffers == 0);
+    REQUIRE(array.children[4]->null_count == 2);
+
+    array.release(&array);
+    schema.release(&schema);
+    REQUIRE(array.release == nullptr);
+    REQUIRE(schema.release == nullptr);
+
+    // The batch can be refilled after exporting
+    REQUIRE(results.next_batch(batch, 10) == 0);
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
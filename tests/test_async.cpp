@@ -0,0 +1,114 @@
+#include <thread>
+#include "catch.hpp"
+#include "sqlite_async.h"
+
+using namespace SQLite;
+
+/** Test running queries on an AsyncConn's worker thread */
+TEST_CASE("Async Query Test", "[test_async]") {
+    {
+        SQLite::AsyncConn db("database.sqlite");
+        db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int)");
+
+        // Pipeline many inserts without waiting on each one
+        std::vector<std::future<void>> inserts;
+        for (int i = 0; i < 100; i++)
+            inserts.push_back(db.submit([i](Conn& conn) {
+                auto stmt = conn.prepare("INSERT INTO dillydilly VALUES (?, ?)");
+                stmt.bind("Player " + std::to_string(i), i);
+                stmt.commit();
+            }));
+
+        auto count = db.submit([](Conn& conn) {
+            auto results = conn.query("SELECT count(*) FROM dillydilly");
+            RowView row;
+            results.next(row);
+            return row[0].get<long long int>();
+        });
+
+        auto results = db.query("SELECT * FROM dillydilly WHERE Touchdown < 2");
+        for (auto& insert : inserts) insert.get();
+        REQUIRE(count.get() == 100);
+
+        auto result = results.get();
+        REQUIRE(result.col_names == std::vector<std::string>({ "Player", "Touchdown" }));
+        REQUIRE(result.rows.size() == 2);
+        REQUIRE(result.rows[1][0].get<std::string>() == "Player 1");
+        REQUIRE(result.rows[1][1].get<long long int>() == 1);
+
+        // Errors are delivered through the future
+        auto bad = db.exec("SELECT * FROM nonexistent");
+        REQUIRE_THROWS_AS(bad.get(), SQLiteError);
+
+        // Completion callbacks run on the worker thread
+        std::promise<std::thread::id> callback_thread;
+        db.submit([](Conn&) { return std::this_thread::get_id(); },
+            [&callback_thread](std::future<std::thread::id> worker) {
+                callback_thread.set_value(worker.get());
+            });
+        REQUIRE(callback_thread.get_future().get() != std::this_thread::get_id());
+
+        // Futures become ready before the counters are updated, so
+        // close() to wait for the worker to finish
+        db.close();
+        REQUIRE_THROWS_AS(db.exec("SELECT 1"), DatabaseClosed);
+
+        auto stats = db.get_stats();
+        REQUIRE(stats.completed == stats.submitted);
+        REQUIRE(stats.submitted == 105);
+        REQUIRE(stats.failed == 1);
+        REQUIRE(stats.queue_depth == 0);
+        REQUIRE(stats.max_queue_depth >= 1);
+        REQUIRE(stats.total_latency >= stats.max_latency);
+        REQUIRE(stats.latency_ns.count == 105);
+        REQUIRE(stats.latency_ns.max == (uint64_t)stats.max_latency.count());
+        REQUIRE(stats.latency_ns.percentile(0.5) <= stats.latency_ns.max);
+    }
+
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test that requests submitted from many threads all run */
+TEST_CASE("Async Concurrent Submit Test", "[test_async_threads]") {
+    {
+        SQLite::AsyncConn db("database.sqlite");
+        db.exec("CREATE TABLE dillydilly (Touchdown int)").get();
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+            threads.emplace_back([&db]() {
+                for (int i = 0; i < 50; i++)
+                    db.exec("INSERT INTO dillydilly VALUES (1)");
+            });
+
+        for (auto& thread : threads) thread.join();
+
+        // Closing finishes everything already submitted
+        db.close();
+        REQUIRE(db.get_stats().completed == 201);
+    }
+
+    SQLite::Conn db("database.sqlite");
+    auto results = db.query("SELECT count(*) FROM dillydilly");
+    RowView row;
+    REQUIRE(results.next(row));
+    REQUIRE(row[0].get<long long int>() == 200);
+    results.close();
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test closing an AsyncConn from one of its own requests */
+TEST_CASE("Async Close From Worker Test", "[test_async_close]") {
+    {
+        SQLite::AsyncConn db("database.sqlite");
+        auto closed = db.submit([&db](Conn&) { db.close(); });
+        closed.get();
+
+        // Nothing new is accepted, and the worker is joined by the destructor
+        REQUIRE_THROWS_AS(db.exec("SELECT 1"), DatabaseClosed);
+    }
+
+    REQUIRE(remove("database.sqlite") == 0);
+}
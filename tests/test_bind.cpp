@@ -0,0 +1,98 @@
+#include "catch.hpp"
+#include "sqlite_cpp.h"
+
+using namespace SQLite;
+
+/** Test binding text without copying it, and by moving it in */
+TEST_CASE("Text Binding Modes Test", "[test_bind_modes]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Team TEXT)");
+
+    std::string long_name(1000, 'x');
+    {
+        auto stmt = db.prepare("INSERT INTO dillydilly VALUES (?, ?)");
+
+        // Borrowed
+        std::string player = "Tom Brady";
+        stmt.bind(std::string_view(player), std::string_view("Patriots"));
+
+        // Moved in, both short and heap allocated strings
+        std::string team = "Saints";
+        stmt.bind(std::string("Drew Brees"), std::move(team));
+
+        std::string copy = long_name;
+        stmt.bind(std::move(copy), "Long");
+
+        // Binding one parameter at a time, then stepping. Indices must be
+        // size_t, or else bind(Args...) would treat them as values.
+        const size_t PLAYER = 0, TEAM = 1;
+        std::string one = "Aaron Rodgers", two = "Packers";
+        stmt.bind(PLAYER, std::move(one));
+        stmt.bind(TEAM, std::string_view(two));
+        stmt.next();
+
+        // Rebinding a moved in parameter releases the old string
+        stmt.bind(PLAYER, std::string("Cam Newton"));
+        stmt.bind(TEAM, std::string("Panthers"));
+        stmt.next();
+        stmt.commit();
+    }
+
+    auto results = db.query("SELECT * FROM dillydilly");
+    std::vector<std::string> row;
+    std::vector<std::vector<std::string>> rows;
+    while (results.next(row))
+        rows.push_back(row);
+
+    REQUIRE(rows.size() == 5);
+    REQUIRE(rows[0] == std::vector<std::string>({ "Tom Brady", "Patriots" }));
+    REQUIRE(rows[1] == std::vector<std::string>({ "Drew Brees", "Saints" }));
+    REQUIRE(rows[2] == std::vector<std::string>({ long_name, "Long" }));
+    REQUIRE(rows[3] == std::vector<std::string>({ "Aaron Rodgers", "Packers" }));
+    REQUIRE(rows[4] == std::vector<std::string>({ "Cam Newton", "Panthers" }));
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test that empty views are bound as empty text, not NULL */
+TEST_CASE("Empty Text Binding Test", "[test_bind_empty]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT)");
+
+    auto stmt = db.prepare("INSERT INTO dillydilly VALUES (?)");
+    stmt.bind(std::string_view());
+    stmt.commit();
+
+    auto results = db.query("SELECT Player IS NULL, length(Player) FROM dillydilly");
+    RowView row;
+    REQUIRE(results.next(row));
+    REQUIRE(row[0].get<int>() == 0);
+    REQUIRE(row[1].get<int>() == 0);
+    results.close();
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test binding parameters of a query before reading it */
+TEST_CASE("Query Parameter Binding Test", "[test_bind_query]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int)");
+    db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28)");
+    db.exec("INSERT INTO dillydilly VALUES ('Drew Brees', 21)");
+
+    RowView row;
+    for (long long int touchdowns : { 28, 21 }) {
+        auto results = db.query("SELECT Player FROM dillydilly WHERE Touchdown = ?");
+        results.bind(0, touchdowns);
+        REQUIRE(results.next(row));
+        REQUIRE(row[0].get<std::string_view>() == (touchdowns == 28 ? "Tom Brady" : "Drew Brees"));
+        REQUIRE(!results.next(row));
+    }
+
+    REQUIRE(db.get_cache_stats().hits == 1);
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
@@ -0,0 +1,105 @@
+#include <sstream>
+#include "catch.hpp"
+#include "sqlite_cpp.h"
+
+using namespace SQLite;
+
+/** Test binding and fetching BLOBs */
+TEST_CASE("BLOB Round Trip Test", "[test_blob]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE images (name TEXT, data BLOB)");
+
+    Blob image = { 0x89, 'P', 'N', 'G', 0, 0xff, 0 };
+    auto stmt = db.prepare("INSERT INTO images VALUES (?, ?)");
+    stmt.bind("Tom Brady", image);
+    stmt.bind("Empty", Blob());
+    stmt.commit();
+
+    auto results = db.query("SELECT data FROM images");
+    std::vector<SQLField> row;
+
+    REQUIRE(results.next(row));
+    REQUIRE(row[0].type() == SQLITE_BLOB);
+    REQUIRE(row[0].get<Blob>() == image);
+
+    // Empty BLOBs are not NULL
+    REQUIRE(results.next(row));
+    REQUIRE(row[0].type() == SQLITE_BLOB);
+    REQUIRE(row[0].get<Blob>().empty());
+    REQUIRE_FALSE(results.next(row));
+
+    auto typed = db.query_as<std::tuple<std::string, Blob>>("SELECT * FROM images");
+    std::tuple<std::string, Blob> typed_row;
+    REQUIRE(typed.next(typed_row));
+    REQUIRE(std::get<1>(typed_row) == image);
+    typed.close();
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test reading and writing BLOBs incrementally */
+TEST_CASE("BLOB Stream Test", "[test_blob_stream]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE images (data BLOB)");
+
+    const size_t size = 1000000;
+    auto stmt = db.prepare("INSERT INTO images VALUES (?)");
+    stmt.bind(ZeroBlob{ size });
+    stmt.bind(ZeroBlob{ 10 });
+    stmt.commit();
+
+    std::string payload(size, '\0');
+    for (size_t i = 0; i < size; i++)
+        payload[i] = (char)(i * 7);
+
+    SECTION("Chunked Writes and Reads") {
+        {
+            auto blob = db.open_blob("images", "data", 1, true);
+            REQUIRE(blob.size() == size);
+
+            std::istringstream in(payload);
+            REQUIRE_THROWS_AS(blob.copy_from(in, 0), ValueError);
+            REQUIRE(blob.copy_from(in, 4096) == size);
+            REQUIRE(blob.tell() == size);
+            REQUIRE_THROWS_AS(blob.write("x", 1), ValueError);
+        }
+
+        auto blob = db.open_blob("images", "data", 1);
+        std::ostringstream out;
+        REQUIRE(blob.copy_to(out, 4096) == size);
+        REQUIRE(out.str() == payload);
+
+        char buffer[16];
+        blob.seek(size - 4);
+        REQUIRE(blob.read(buffer, sizeof(buffer)) == 4);
+        REQUIRE(std::string(buffer, 4) == payload.substr(size - 4));
+        REQUIRE(blob.read(buffer, sizeof(buffer)) == 0);
+        REQUIRE_THROWS_AS(blob.seek(size + 1), ValueError);
+
+        blob.reopen(2);
+        REQUIRE(blob.size() == 10);
+        REQUIRE(blob.read(buffer, sizeof(buffer)) == 10);
+        REQUIRE(std::string(buffer, 10) == std::string(10, '\0'));
+    }
+
+    SECTION("Read Only") {
+        auto blob = db.open_blob("images", "data", 1);
+        REQUIRE_THROWS_AS(blob.write("x", 1), SQLiteError);
+    }
+
+    SECTION("Missing Row") {
+        REQUIRE_THROWS_AS(db.open_blob("images", "data", 3), SQLiteError);
+    }
+
+    SECTION("Closed Connection") {
+        auto blob = db.open_blob("images", "data", 1);
+        db.close();
+
+        char buffer[16];
+        REQUIRE_THROWS_AS(blob.read(buffer, sizeof(buffer)), DatabaseClosed);
+    }
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
@@ -0,0 +1,85 @@
+#include <tuple>
+#include "catch.hpp"
+#include "sqlite_cpp.h"
+
+using namespace SQLite;
+
+/** Test that rows are batched into multi-row INSERTs and chunked commits */
+TEST_CASE("Bulk Insert Test", "[test_bulk_insert]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE numbers (Name TEXT, Value int, Half real)");
+
+    BulkInsertOptions options;
+    options.rows_per_statement = 100;
+    options.rows_per_transaction = 1000;
+
+    auto loader = db.bulk_insert<std::string, int, double>("numbers", {}, options);
+    for (int i = 0; i < 2550; i++)
+        loader.insert(std::to_string(i), i, i / 2.0);
+    loader.commit();
+
+    auto stats = loader.get_stats();
+    REQUIRE(stats.rows == 2550);
+    REQUIRE(stats.statements == 26);   // 25 full statements + 1 partial
+    REQUIRE(stats.transactions == 3);
+
+    auto results = db.query("SELECT COUNT(*), SUM(Value), MAX(Half) FROM numbers");
+    std::vector<SQLField> row;
+    REQUIRE(results.next(row));
+    REQUIRE(row[0].get<long long int>() == 2550);
+    REQUIRE(row[1].get<long long int>() == 2550 * 2549 / 2);
+    REQUIRE(row[2].get<double>() == 1274.5);
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test inserting a range of tuples into named columns */
+TEST_CASE("Bulk Insert Range Test", "[test_bulk_insert]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int, Interception int)");
+
+    std::vector<std::tuple<const char*, long long int>> rows = {
+        { "Tom Brady", 28 }, { "Drew Brees", 21 }, { "Philip Rivers", 24 }
+    };
+
+    auto loader = db.bulk_insert<const char*, long long int>(
+        "dillydilly", { "Player", "Touchdown" });
+    loader.insert_all(rows);
+    loader.commit();
+
+    auto results = db.query("SELECT * FROM dillydilly");
+    std::vector<std::string> row;
+    REQUIRE(results.next(row));
+    REQUIRE(row == std::vector<std::string>({ "Tom Brady", "28", "" }));
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test that uncommitted rows are rolled back */
+TEST_CASE("Bulk Insert Rollback Test", "[test_bulk_insert]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE numbers (Value int PRIMARY KEY)");
+
+    {
+        auto loader = db.bulk_insert<int>("numbers");
+        loader.insert(1);
+        loader.insert(2);
+    }
+
+    {
+        auto loader = db.bulk_insert<int>("numbers");
+        loader.insert(3);
+        loader.insert(3);
+        REQUIRE_THROWS_AS(loader.commit(), SQLiteError);
+    }
+
+    auto results = db.query("SELECT COUNT(*) FROM numbers");
+    std::vector<SQLField> row;
+    REQUIRE(results.next(row));
+    REQUIRE(row[0].get<long long int>() == 0);
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
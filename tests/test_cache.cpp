@@ -0,0 +1,104 @@
+#include "catch.hpp"
+#include "sqlite_cpp.h"
+
+using namespace SQLite;
+
+/** Test that repeated queries reuse cached statements */
+TEST_CASE("Statement Cache Hits", "[test_stmt_cache]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int, Interception int)");
+    db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28, 7)");
+
+    std::vector<std::string> row;
+    for (int i = 0; i < 3; i++) {
+        auto results = db.query("SELECT * FROM dillydilly");
+        REQUIRE(results.next(row));
+        REQUIRE(row == std::vector<std::string>({ "Tom Brady", "28", "7" }));
+        REQUIRE_FALSE(results.next(row));
+    }
+
+    auto stats = db.get_cache_stats();
+    REQUIRE(stats.misses == 1);
+    REQUIRE(stats.hits == 2);
+    REQUIRE(stats.evictions == 0);
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test that a statement abandoned mid-iteration is reset before reuse */
+TEST_CASE("Statement Cache Reset", "[test_stmt_cache]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int, Interception int)");
+    db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28, 7)");
+    db.exec("INSERT INTO dillydilly VALUES ('Drew Brees', 21, 7)");
+
+    std::vector<std::string> row;
+    {
+        auto results = db.query("SELECT Player FROM dillydilly");
+        REQUIRE(results.next(row));
+    }
+
+    auto results = db.query("SELECT Player FROM dillydilly");
+    REQUIRE(results.next(row));
+    REQUIRE(row[0] == "Tom Brady");
+    REQUIRE(db.get_cache_stats().hits == 1);
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test that the least recently used statement is evicted */
+TEST_CASE("Statement Cache Eviction", "[test_stmt_cache]") {
+    SQLite::Conn db("database.sqlite");
+    db.set_cache_capacity(2);
+    REQUIRE(db.get_cache_capacity() == 2);
+
+    db.query("SELECT 1");
+    db.query("SELECT 2");
+    db.query("SELECT 3"); // Evicts "SELECT 1"
+    REQUIRE(db.get_cache_stats().evictions == 1);
+
+    db.query("SELECT 3");
+    db.query("SELECT 1");
+    auto stats = db.get_cache_stats();
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.misses == 4);
+
+    // Disabling the cache finalizes everything
+    db.set_cache_capacity(0);
+    db.query("SELECT 3");
+    REQUIRE(db.get_cache_stats().misses == 5);
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test that only statements still in use are tracked by the connection */
+TEST_CASE("Statement Registry", "[test_stmt_registry]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int)");
+
+    for (int i = 0; i < 10000; i++) {
+        auto stmt = db.prepare("INSERT INTO dillydilly VALUES (?, ?)");
+        stmt.bind("Tom Brady", i);
+    }
+
+    REQUIRE(db.open_statements() == 0);
+
+    auto first = db.query("SELECT 1");
+    auto second = db.query("SELECT 2");
+    auto third = db.query("SELECT 3");
+    REQUIRE(db.open_statements() == 3);
+
+    second.close(); // Unlinked from the middle
+    REQUIRE(db.open_statements() == 2);
+
+    // Closing the connection closes the rest
+    db.close();
+    REQUIRE(db.open_statements() == 0);
+    RowView row;
+    REQUIRE_THROWS_AS(first.next(row), StatementClosed);
+    REQUIRE_THROWS_AS(third.next(row), StatementClosed);
+    REQUIRE(remove("database.sqlite") == 0);
+}
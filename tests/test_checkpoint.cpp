@@ -0,0 +1,156 @@
+#include <thread>
+#include "catch.hpp"
+#include "sqlite_checkpoint.h"
+
+using namespace SQLite;
+
+static long long int query_int(SQLite::Conn& db, const std::string& stmt) {
+    auto results = db.query(stmt);
+    RowView row;
+    results.next(row);
+    return row[0].get<long long int>();
+}
+
+/** Test that ConnOptions are applied when connecting */
+TEST_CASE("Connection Options Test", "[test_conn_options]") {
+    auto options = ConnOptions::wal_profile();
+    options.wal_autocheckpoint = 0;
+    SQLite::Conn db("database.sqlite", options);
+
+    {
+        auto results = db.query("PRAGMA journal_mode");
+        RowView row;
+        results.next(row);
+        REQUIRE(row[0].get<std::string_view>() == "wal");
+    }
+
+    REQUIRE(query_int(db, "PRAGMA synchronous") == 1);
+    REQUIRE(query_int(db, "PRAGMA temp_store") == 2);
+    REQUIRE(query_int(db, "PRAGMA cache_size") == -65536);
+    REQUIRE(query_int(db, "PRAGMA wal_autocheckpoint") == 0);
+
+    // Refusing to switch to WAL mode is an error
+    REQUIRE_THROWS_AS(SQLite::Conn(":memory:", options), SQLiteError);
+
+    // Nothing is changed by default
+    SQLite::Conn other("database.sqlite", ConnOptions());
+    REQUIRE(query_int(other, "PRAGMA synchronous") == 2);
+    REQUIRE(query_int(other, "PRAGMA wal_autocheckpoint") == 1000);
+
+    other.close();
+
+    // Checkpointing needs WAL mode
+    db.exec("PRAGMA journal_mode=DELETE");
+    REQUIRE_THROWS_AS(CheckpointScheduler("database.sqlite"), ValueError);
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test opening a database as a read-only, immutable snapshot */
+TEST_CASE("Snapshot Options Test", "[test_snapshot]") {
+    SQLite::Conn writer("database.sqlite");
+    writer.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int)");
+    writer.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28)");
+
+    SQLite::Conn snapshot("database.sqlite", ConnOptions::snapshot_profile());
+    REQUIRE(query_int(snapshot, "SELECT Touchdown FROM dillydilly") == 28);
+    REQUIRE(query_int(snapshot, "PRAGMA mmap_size") > 0);
+    REQUIRE(sqlite3_db_readonly(snapshot.get_ptr(), "main") == 1);
+    REQUIRE_THROWS_AS(snapshot.exec("INSERT INTO dillydilly VALUES ('Drew Brees', 21)"),
+        SQLiteError);
+
+    // Immutable readers ignore locks, so a writer holding one doesn't block them
+    writer.exec("BEGIN EXCLUSIVE");
+    SQLite::Conn reader("database.sqlite");
+    REQUIRE_THROWS(query_int(reader, "SELECT count(*) FROM dillydilly"));
+    REQUIRE(query_int(snapshot, "SELECT count(*) FROM dillydilly") == 1);
+    writer.exec("COMMIT");
+    reader.close();
+
+    // URIs get immutable=1 appended
+    SQLite::Conn uri("file:database.sqlite?mode=ro", ConnOptions::snapshot_profile());
+    REQUIRE(query_int(uri, "SELECT count(*) FROM dillydilly") == 1);
+    uri.close();
+
+    ConnOptions read_only;
+    read_only.read_only = true;
+    REQUIRE_THROWS_AS(SQLite::Conn("missing.sqlite", read_only), SQLiteError);
+    read_only.wal = true;
+    REQUIRE_THROWS_AS(SQLite::Conn("database.sqlite", read_only), ValueError);
+
+    snapshot.close();
+    writer.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test checkpointing a database from a background thread */
+TEST_CASE("Checkpoint Scheduler Test", "[test_checkpoint]") {
+    auto options = ConnOptions::wal_profile();
+    options.wal_autocheckpoint = 0;
+    SQLite::Conn db("database.sqlite", options);
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int)");
+
+    // Keeps the rows inserted below from being checkpointed
+    SQLite::Conn reader("database.sqlite");
+    reader.exec("BEGIN");
+    REQUIRE(query_int(reader, "SELECT count(*) FROM dillydilly") == 0);
+
+    {
+        auto txn = db.transaction();
+        auto stmt = db.prepare("INSERT INTO dillydilly VALUES (?, ?)");
+        for (int i = 0; i < 1000; i++)
+            stmt.bind("Player " + std::to_string(i), i);
+        txn.commit();
+    }
+
+    CheckpointOptions checkpoint_options;
+    checkpoint_options.interval = std::chrono::seconds(60);
+    checkpoint_options.wal_budget = 0; // Escalate whenever anything is left
+    checkpoint_options.busy_timeout = 10000;
+    SQLite::CheckpointScheduler checkpointer("database.sqlite", checkpoint_options);
+
+    auto wait_for = [&checkpointer](size_t passive, size_t forced) {
+        auto stats = checkpointer.get_stats();
+        for (int i = 0; i < 500 && (stats.passive < passive || stats.forced < forced); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            stats = checkpointer.get_stats();
+        }
+
+        return stats;
+    };
+
+    // The passive checkpoint can't copy what the reader might still need,
+    // so the scheduler escalates and waits for the reader to finish
+    checkpointer.checkpoint_now();
+    auto stats = wait_for(1, 0);
+    REQUIRE(stats.passive == 1);
+    REQUIRE(stats.backlog_bytes > 0);
+    reader.exec("COMMIT");
+
+    stats = wait_for(1, 1);
+    REQUIRE(stats.forced == 1);
+    REQUIRE(stats.busy == 0);
+    REQUIRE(stats.failed == 0);
+    REQUIRE(stats.max_wal_bytes > 0);
+    REQUIRE(stats.wal_bytes == 0); // Truncated
+    REQUIRE(stats.backlog_bytes == 0);
+    REQUIRE(stats.duration_ns.count == 2);
+
+    // Nothing is left to copy, so there is no need to escalate again
+    db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28)");
+    checkpointer.checkpoint_now();
+    stats = wait_for(2, 1);
+    REQUIRE(stats.passive == 2);
+    REQUIRE(stats.wal_bytes > 0);
+    REQUIRE(stats.backlog_bytes == 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE(checkpointer.get_stats().forced == 1);
+
+    checkpointer.stop();
+    REQUIRE(query_int(db, "SELECT count(*) FROM dillydilly") == 1001);
+    reader.close();
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
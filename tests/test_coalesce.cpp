@@ -0,0 +1,150 @@
+#include <thread>
+#include "catch.hpp"
+#include "sqlite_coalesce.h"
+
+using namespace SQLite;
+
+/** Test committing many threads' writes together */
+TEST_CASE("Write Coalescer Test", "[test_coalesce]") {
+    {
+        SQLite::Conn db("database.sqlite");
+        db.exec("CREATE TABLE dillydilly (Player TEXT PRIMARY KEY, Touchdown int)");
+    }
+
+    {
+        WriteCoalescerOptions options;
+        options.max_batch_size = 50;
+        options.max_batch_latency = std::chrono::milliseconds(20);
+        SQLite::WriteCoalescer writer("database.sqlite", options);
+
+        // Eight threads each inserting 25 rows
+        std::vector<std::thread> threads;
+        std::vector<std::future<long long int>> rowids(200);
+        for (int t = 0; t < 8; t++) {
+            threads.emplace_back([&writer, &rowids, t]() {
+                for (int i = t * 25; i < (t + 1) * 25; i++) {
+                    rowids[i] = writer.submit([i](Conn& conn) {
+                        auto stmt = conn.prepare("INSERT INTO dillydilly VALUES (?, ?)");
+                        stmt.bind("Player " + std::to_string(i), i);
+                        return (long long int)sqlite3_last_insert_rowid(conn.get_ptr());
+                    });
+                }
+            });
+        }
+
+        for (auto& thread : threads) thread.join();
+        for (auto& rowid : rowids) REQUIRE(rowid.get() > 0);
+
+        // A failed write is rolled back without affecting the others
+        auto before = writer.submit([](Conn& conn) {
+            conn.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28)");
+        });
+        auto duplicate = writer.submit([](Conn& conn) {
+            conn.exec("INSERT INTO dillydilly VALUES ('Drew Brees', 21)");
+            conn.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28)");
+        });
+        auto after = writer.submit([](Conn& conn) {
+            conn.exec("INSERT INTO dillydilly VALUES ('Cam Newton', 22)");
+        });
+
+        before.get();
+        REQUIRE_THROWS_AS(duplicate.get(), SQLiteError);
+        after.get();
+
+        // Statistics are updated before futures become ready
+        auto stats = writer.get_stats();
+        REQUIRE(stats.writes == 203);
+        REQUIRE(stats.failed == 1);
+        REQUIRE(stats.batch_sizes.count == stats.batches);
+        REQUIRE(stats.batch_sizes.sum == 203);
+        REQUIRE(stats.batches < 203);
+        REQUIRE(stats.batch_sizes.max <= 50);
+        REQUIRE(stats.latency_ns.count == 203);
+
+        writer.close();
+        REQUIRE_THROWS_AS(writer.submit([](Conn&) {}), DatabaseClosed);
+    }
+
+    SQLite::Conn db("database.sqlite");
+    auto results = db.query("SELECT count(*) FROM dillydilly");
+    RowView row;
+    results.next(row);
+    REQUIRE(row[0].get<long long int>() == 202);
+
+    auto drew = db.query("SELECT * FROM dillydilly WHERE Player = 'Drew Brees'");
+    REQUIRE_FALSE(drew.next(row));
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test that close() commits writes which are still queued */
+TEST_CASE("Write Coalescer Close Test", "[test_coalesce_close]") {
+    {
+        SQLite::Conn db("database.sqlite");
+        db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int)");
+    }
+
+    std::vector<std::future<void>> writes;
+    {
+        WriteCoalescerOptions options;
+        options.max_batch_latency = std::chrono::seconds(10);
+        SQLite::WriteCoalescer writer("database.sqlite", options);
+        for (int i = 0; i < 10; i++)
+            writes.push_back(writer.submit([i](Conn& conn) {
+                auto stmt = conn.prepare("INSERT INTO dillydilly VALUES (?, ?)");
+                stmt.bind("Player " + std::to_string(i), i);
+            }));
+    }   // Doesn't wait for max_batch_latency
+
+    for (auto& write : writes) write.get();
+
+    SQLite::Conn db("database.sqlite");
+    auto results = db.query("SELECT count(*) FROM dillydilly");
+    RowView row;
+    results.next(row);
+    REQUIRE(row[0].get<long long int>() == 10);
+
+    results.close();
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test calling close() from a write, and waiting for other writers */
+TEST_CASE("Write Coalescer Worker Close Test", "[test_coalesce_close]") {
+    {
+        SQLite::Conn db("database.sqlite");
+        db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int)");
+    }
+
+    {
+        SQLite::WriteCoalescer writer("database.sqlite");
+
+        // Another connection holding the write lock only delays the batch
+        SQLite::Conn other("database.sqlite");
+        auto txn = other.transaction(TransactionMode::IMMEDIATE);
+        auto write = writer.submit([](Conn& conn) {
+            conn.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28)");
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        txn.commit();
+        write.get();
+
+        auto closed = writer.submit([&writer](Conn&) { writer.close(); });
+        closed.get();
+
+        // Nothing new is accepted, and the worker is joined by the destructor
+        REQUIRE_THROWS_AS(writer.submit([](Conn&) {}), DatabaseClosed);
+        other.close();
+    }
+
+    SQLite::Conn db("database.sqlite");
+    auto results = db.query("SELECT count(*) FROM dillydilly");
+    RowView row;
+    results.next(row);
+    REQUIRE(row[0].get<long long int>() == 1);
+
+    results.close();
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
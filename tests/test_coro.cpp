@@ -0,0 +1,84 @@
+#include "catch.hpp"
+#include "sqlite_coro.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+using namespace SQLite;
+
+/** A coroutine which starts immediately and is never awaited */
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+/** What count_rows() saw, checked on the main thread since Catch's
+ *  assertions can't be used from the worker thread the coroutine resumes on
+ */
+struct CountResult {
+    long long int count = 0;  /**< From SELECT count(*) */
+    size_t rows = 0;          /**< Rows streamed */
+    long long int sum = 0;    /**< Sum of the rows streamed */
+    size_t max_batch = 0;     /**< Largest batch streamed */
+    std::vector<std::string> col_names;
+};
+
+Detached count_rows(AsyncConn& db, std::promise<CountResult>& out) {
+    try {
+        CountResult counted;
+        co_await co_exec(db, "CREATE TABLE dillydilly (Touchdown int)");
+        co_await co_submit(db, [](Conn& conn) {
+            auto loader = conn.bulk_insert<long long int>("dillydilly");
+            for (long long int i = 0; i < 2500; i++)
+                loader.insert(i);
+            loader.commit();
+        });
+
+        auto result = co_await co_query(db, "SELECT count(*) FROM dillydilly");
+        counted.count = result.rows[0][0].get<long long int>();
+
+        RowStream stream(db, "SELECT Touchdown FROM dillydilly", 1000);
+        while (co_await stream.next()) {
+            counted.col_names = stream.col_names();
+            counted.max_batch = std::max(counted.max_batch, stream.batch().size());
+            for (auto& row : stream.batch()) {
+                counted.sum += row[0].get<long long int>();
+                counted.rows++;
+            }
+        }
+
+        out.set_value(std::move(counted));
+    }
+    catch (...) {
+        out.set_exception(std::current_exception());
+    }
+}
+
+/** Test awaiting queries and streaming rows from an AsyncConn */
+TEST_CASE("Coroutine Query Test", "[test_coro]") {
+    {
+        SQLite::AsyncConn db("database.sqlite");
+        std::promise<CountResult> out;
+        count_rows(db, out);
+
+        auto result = out.get_future().get();
+        REQUIRE(result.count == 2500);
+        REQUIRE(result.rows == 2500);
+        REQUIRE(result.sum == 2500 * 2499 / 2);
+        REQUIRE(result.max_batch == 1000);
+        REQUIRE(result.col_names == std::vector<std::string>({ "Touchdown" }));
+    }
+
+    SQLite::Conn db("database.sqlite");
+    long long int expected = 0;
+    for (auto& row : SQLite::rows(db.query("SELECT Touchdown FROM dillydilly WHERE Touchdown < 10")))
+        REQUIRE(row[0].get<long long int>() == expected++);
+    REQUIRE(expected == 10);
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+#endif
@@ -0,0 +1,119 @@
+#include <sstream>
+#include "catch.hpp"
+#include "sqlite_csv.h"
+
+using namespace SQLite;
+
+/** Run an import and return every row of the table */
+static std::vector<std::vector<std::string>> import_rows(const std::string& csv,
+    CSVImportOptions options) {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int, Interception int)");
+
+    std::istringstream in(csv);
+    auto stats = import_csv(db, in, "dillydilly", options);
+    REQUIRE(stats.bytes == csv.size());
+
+    std::vector<std::vector<std::string>> rows;
+    std::vector<std::string> row;
+    auto results = db.query("SELECT * FROM dillydilly");
+    while (results.next(row))
+        rows.push_back(row);
+
+    REQUIRE(stats.rows == rows.size());
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+    return rows;
+}
+
+/** Test parsing quoted fields, line endings, and records split across chunks */
+TEST_CASE("CSV Import Test", "[test_csv_import]") {
+    std::string csv = "Player,Touchdown,Interception\r\n"
+        "Tom Brady,28,7\r\n"
+        "\"Roethlisberger, Ben\",26,14\n"
+        "\n"
+        "\"Matthew \"\"Matt\"\" Stafford\",25,9\n"
+        "\"Drew\nBrees\",21,\n"
+        "Philip Rivers,24,10";
+
+    std::vector<std::vector<std::string>> expected = {
+        { "Tom Brady", "28", "7" },
+        { "Roethlisberger, Ben", "26", "14" },
+        { "Matthew \"Matt\" Stafford", "25", "9" },
+        { "Drew\nBrees", "21", "" },
+        { "Philip Rivers", "24", "10" }
+    };
+
+    for (bool threaded : { true, false }) {
+        for (size_t chunk_size : { 1, 7, 64, 1 << 16 }) {
+            CSVImportOptions options;
+            options.threaded = threaded;
+            options.chunk_size = chunk_size;
+            options.rows_per_transaction = 2;
+            REQUIRE(import_rows(csv, options) == expected);
+        }
+    }
+}
+
+/** Test that malformed files are rejected */
+TEST_CASE("CSV Import Errors", "[test_csv_import]") {
+    for (bool threaded : { true, false }) {
+        CSVImportOptions options;
+        options.threaded = threaded;
+        options.header = false;
+        options.chunk_size = 16;
+
+        SQLite::Conn db("database.sqlite");
+        db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int, Interception int)");
+
+        std::istringstream ragged("Tom Brady,28,7\nDrew Brees,21\n");
+        REQUIRE_THROWS_AS(import_csv(db, ragged, "dillydilly", options), ValueError);
+
+        std::istringstream unterminated("Tom Brady,28,7\n\"Drew Brees,21,7\n");
+        REQUIRE_THROWS_AS(import_csv(db, unterminated, "dillydilly", options), ValueError);
+
+        REQUIRE_THROWS_AS(import_csv(db, "does_not_exist.csv", "dillydilly", options), ValueError);
+
+        db.close();
+        REQUIRE(remove("database.sqlite") == 0);
+    }
+}
+
+/** Test that empty fields are NULL unless quoted, and that constraint
+ *  failures are reported with SQLite's message
+ */
+TEST_CASE("CSV Import Values", "[test_csv_import]") {
+    CSVImportOptions options;
+    options.header = false;
+
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT UNIQUE, Touchdown int, Interception int)");
+
+    std::istringstream empty("Tom Brady,,\"\"\n");
+    import_csv(db, empty, "dillydilly", options);
+
+    auto results = db.query("SELECT typeof(Touchdown), typeof(Interception) FROM dillydilly");
+    std::vector<std::string> row;
+    REQUIRE(results.next(row));
+    REQUIRE(row == std::vector<std::string>({ "null", "text" }));
+    results.close();
+
+    std::istringstream duplicate("Drew Brees,21,7\nTom Brady,28,7\n");
+    try {
+        import_csv(db, duplicate, "dillydilly", options);
+        FAIL("Expected a constraint violation");
+    }
+    catch (SQLite::SQLiteError& e) {
+        REQUIRE(std::string(e.what()).find("UNIQUE constraint failed: dillydilly.Player")
+            != std::string::npos);
+    }
+
+    // The failed transaction was rolled back
+    results = db.query("SELECT count(*) FROM dillydilly");
+    REQUIRE(results.next(row));
+    REQUIRE(row[0] == "1");
+    results.close();
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
@@ -0,0 +1,95 @@
+#include "catch.hpp"
+#include "sqlite_cpp.h"
+
+using namespace SQLite;
+
+static double half(double x) { return x / 2; }
+
+/** Test registering C++ functions for use in SQL */
+TEST_CASE("User Defined Function Test", "[test_function]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int, Interception int)");
+    db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28, 7)");
+    db.exec("INSERT INTO dillydilly VALUES ('Drew Brees', 21, NULL)");
+
+    int calls = 0;
+    db.create_function("td_ratio", [&calls](long long int td, std::optional<long long int> ints) {
+        calls++;
+        return ints ? (double)td / (*ints + 1) : (double)td;
+    }, true);
+
+    db.create_function("initials", [](std::string_view name) {
+        std::string ret;
+        bool start = true;
+        for (char ch : name) {
+            if (start && ch != ' ') ret += ch;
+            start = (ch == ' ');
+        }
+        return ret;
+    });
+
+    db.create_function("half", &half);
+    db.create_function("maybe_null", [](int x) -> std::optional<int> {
+        if (x) return x;
+        return std::nullopt;
+    });
+    db.create_function("reverse_blob", [](BlobView blob) {
+        return Blob(std::make_reverse_iterator(blob.data + blob.size),
+            std::make_reverse_iterator(blob.data));
+    });
+    db.create_function("check_positive", [](double x) {
+        if (x < 0) throw ValueError("Expected a positive number");
+        return x;
+    });
+    db.create_function("noop", []() {});
+
+    SECTION("Arguments and Results") {
+        auto results = db.query("SELECT initials(Player), td_ratio(Touchdown, Interception) "
+            "FROM dillydilly ORDER BY Touchdown DESC");
+        RowView row;
+        REQUIRE(results.next(row));
+        REQUIRE(row[0].get<std::string_view>() == "TB");
+        REQUIRE(row[1].get<double>() == 3.5);
+        REQUIRE(results.next(row));
+        REQUIRE(row[0].get<std::string_view>() == "DB");
+        REQUIRE(row[1].get<double>() == 21);
+        REQUIRE(calls == 2);
+    }
+
+    SECTION("Other Types") {
+        auto results = db.query("SELECT half(5), maybe_null(0), maybe_null(3), "
+            "hex(reverse_blob(x'010203')), noop()");
+        RowView row;
+        REQUIRE(results.next(row));
+        REQUIRE(row[0].get<double>() == 2.5);
+        REQUIRE(row[1].is_null());
+        REQUIRE(row[2].get<int>() == 3);
+        REQUIRE(row[3].get<std::string_view>() == "030201");
+        REQUIRE(row[4].is_null());
+    }
+
+    SECTION("Exceptions Become SQL Errors") {
+        REQUIRE_NOTHROW(db.exec("SELECT check_positive(1)"));
+        REQUIRE_THROWS_AS(db.exec("SELECT check_positive(-1)"), SQLiteError);
+        try {
+            db.exec("SELECT check_positive(-1)");
+        }
+        catch (SQLiteError& e) {
+            REQUIRE(std::string(e.what()).find("Expected a positive number") != std::string::npos);
+        }
+    }
+
+    SECTION("Wrong Number of Arguments") {
+        REQUIRE_THROWS_AS(db.exec("SELECT half(1, 2)"), SQLiteError);
+    }
+
+    SECTION("Deterministic Functions in Indices") {
+        // Only deterministic functions may be used in expression indices
+        REQUIRE_NOTHROW(db.exec("CREATE INDEX ratio_idx ON dillydilly(td_ratio(Touchdown, Interception))"));
+        REQUIRE_THROWS_AS(db.exec("CREATE INDEX initials_idx ON dillydilly(initials(Player))"),
+            SQLiteError);
+    }
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
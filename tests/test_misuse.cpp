@@ -17,6 +17,26 @@ TEST_CASE("Syntax Error", "[test_exec_err]") {
     remove("database.sqlite");
 }
 
+/** Test that statements which can't be prepared fail right away */
+TEST_CASE("Prepare Error", "[test_prepare_err]") {
+    SQLite::Conn db("database.sqlite");
+    bool exception_raised = false;
+
+    try {
+        db.prepare("INSERT INTO nosuch VALUES (?)");
+    }
+    catch (SQLite::SQLiteError& err) {
+        exception_raised = std::string(err.what()).find("no such table") != std::string::npos;
+    }
+
+    REQUIRE(exception_raised);
+    REQUIRE_THROWS_AS(db.query("SELCT 1"), SQLite::SQLiteError);
+    REQUIRE(db.open_statements() == 0);
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
 TEST_CASE("Operation on Closed Database", "[test_closed_db]") {
     SQLite::Conn db("db2.sqlite");
     db.close();
@@ -0,0 +1,78 @@
+#include <atomic>
+#include <thread>
+#include "catch.hpp"
+#include "sqlite_pool.h"
+
+using namespace SQLite;
+
+/** Test that many threads can read through leased connections */
+TEST_CASE("Connection Pool Test", "[test_pool]") {
+    PoolOptions options;
+    options.readers = 4;
+
+    {
+        SQLite::ConnPool pool("database.sqlite", options);
+        {
+            auto db = pool.writer();
+            db->exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int, Interception int)");
+            db->exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28, 7)");
+        }
+
+        std::atomic<int> rows_read(0);
+        std::vector<std::thread> workers;
+        for (int i = 0; i < 8; i++) {
+            workers.emplace_back([&pool, &rows_read]() {
+                for (int j = 0; j < 50; j++) {
+                    auto db = pool.reader();
+                    auto results = db->query("SELECT * FROM dillydilly");
+                    std::vector<std::string> row;
+                    while (results.next(row))
+                        rows_read++;
+                }
+            });
+        }
+
+        for (auto& worker : workers)
+            worker.join();
+
+        REQUIRE(rows_read == 400);
+        auto stats = pool.get_stats();
+        REQUIRE(stats.leases == 401);
+        REQUIRE(stats.readers_in_use == 0);
+        REQUIRE_FALSE(stats.writer_in_use);
+    }
+
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test that readers cannot write and that leases time out */
+TEST_CASE("Connection Pool Misuse", "[test_pool]") {
+    PoolOptions options;
+    options.readers = 1;
+
+    {
+        SQLite::ConnPool pool("database.sqlite", options);
+        pool.writer()->exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int, Interception int)");
+
+        auto reader = pool.reader();
+        REQUIRE_THROWS_AS(reader->exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28, 7)"),
+            SQLiteError);
+        REQUIRE_THROWS_AS(pool.reader(std::chrono::milliseconds(10)), PoolTimeout);
+
+        auto writer = pool.writer();
+        REQUIRE_THROWS_AS(pool.writer(std::chrono::milliseconds(10)), PoolTimeout);
+        writer.release();
+        REQUIRE_NOTHROW(pool.writer(std::chrono::milliseconds(10)));
+        REQUIRE_THROWS_AS(writer->exec("SELECT 1"), DatabaseClosed);
+
+        REQUIRE(pool.get_stats().timeouts == 2);
+
+        // Statements can't outlive their lease
+        reader.release();
+        auto results = pool.reader()->query("SELECT * FROM dillydilly");
+        RowView row;
+        REQUIRE_THROWS_AS(results.next(row), StatementClosed);
+    }
+
+    REQUIRE(remove("database.sqlite") == 0);
+}
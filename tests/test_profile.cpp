@@ -0,0 +1,72 @@
+#include "catch.hpp"
+#include "sqlite_profile.h"
+
+using namespace SQLite;
+
+/** Test grouping statements which differ only by their literals */
+TEST_CASE("SQL Normalization Test", "[test_normalize]") {
+    REQUIRE(Profiler::normalize("SELECT * FROM t WHERE id = 1") ==
+        "SELECT * FROM t WHERE id = ?");
+    REQUIRE(Profiler::normalize("SELECT  *\n FROM t -- comment\n WHERE id = 2.5e-3") ==
+        "SELECT * FROM t WHERE id = ?");
+    REQUIRE(Profiler::normalize("INSERT INTO \"my table\" VALUES ('it''s', x'00ff', ?3, 0x1F)") ==
+        "INSERT INTO \"my table\" VALUES (?, ?, ?, ?)");
+    REQUIRE(Profiler::normalize("SELECT t1.x /* hint */ FROM t1") == "SELECT t1.x FROM t1");
+}
+
+/** Test collecting per-statement profiles */
+TEST_CASE("Profiler Test", "[test_profiler]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int)");
+    db.exec("CREATE TABLE teams (Player TEXT, Team TEXT)");
+
+    auto loader = db.bulk_insert<std::string, long long int>("dillydilly");
+    for (long long int i = 0; i < 200; i++)
+        loader.insert("Player " + std::to_string(i), i);
+    loader.commit();
+
+    SQLite::Profiler profiler(db);
+    for (int i = 0; i < 10; i++) {
+        auto results = db.query("SELECT Player FROM dillydilly WHERE Touchdown = " + std::to_string(i));
+        std::vector<std::string> row;
+        while (results.next(row));
+    }
+
+    {
+        auto results = db.query("SELECT * FROM dillydilly ORDER BY Player");
+        std::vector<std::string> row;
+        while (results.next(row));
+    }
+
+    auto profiles = profiler.get_profiles();
+    auto find = [&profiles](const std::string& sql) {
+        for (auto& profile : profiles)
+            if (profile.sql == sql) return profile;
+        FAIL("No profile for " + sql);
+        return StatementProfile();
+    };
+
+    auto scan = find("SELECT Player FROM dillydilly WHERE Touchdown = ?");
+    REQUIRE(scan.time_ns.count == 10);
+    REQUIRE(scan.fullscan_runs == 10);
+    REQUIRE(scan.fullscan_steps >= 10 * 199);
+    REQUIRE(scan.vm_steps.count == 10);
+    REQUIRE(scan.vm_steps.min > 0);
+    REQUIRE(scan.time_ns.percentile(0.5) <= scan.time_ns.max);
+
+    auto sort = find("SELECT * FROM dillydilly ORDER BY Player");
+    REQUIRE(sort.sorts == 1);
+
+    std::string json = profiler.to_json();
+    REQUIRE(json.find("\"sql\":\"SELECT * FROM dillydilly ORDER BY Player\"") != std::string::npos);
+    REQUIRE(json.find("\"fullscan_runs\":10") != std::string::npos);
+
+    // Nothing is recorded once detached
+    profiler.detach();
+    profiler.reset();
+    db.exec("SELECT 1");
+    REQUIRE(profiler.get_profiles().empty());
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
@@ -0,0 +1,110 @@
+#include "catch.hpp"
+#include "sqlite_cpp.h"
+
+using namespace SQLite;
+
+/** Test reporting slow statements along with their query plans */
+TEST_CASE("Slow Query Log Test", "[test_slow_query]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int)");
+
+    std::vector<SlowQuery> logged;
+    SlowQueryOptions options;
+    options.threshold = std::chrono::microseconds(0); // Log everything
+
+    SECTION("Queries") {
+        db.set_slow_query_log([&logged](const SlowQuery& query) { logged.push_back(query); },
+            options);
+
+        auto stmt = db.prepare("INSERT INTO dillydilly VALUES (?, ?)");
+        stmt.bind("Tom Brady", 28);
+        stmt.commit();
+        REQUIRE(logged.size() == 1);
+        REQUIRE(logged[0].sql == "INSERT INTO dillydilly VALUES (?, ?)");
+        REQUIRE(logged[0].expanded_sql.empty()); // Redacted by default
+
+        auto results = db.query("SELECT * FROM dillydilly WHERE Touchdown > 7");
+        std::vector<std::string> row;
+        while (results.next(row));
+        REQUIRE_FALSE(results.next(row));
+
+        // Logged once, when the last row has been read
+        REQUIRE(logged.size() == 2);
+        REQUIRE(logged[1].elapsed.count() > 0);
+        REQUIRE(logged[1].plan.size() == 1);
+        REQUIRE(logged[1].plan[0].find("SCAN") != std::string::npos);
+    }
+
+    SECTION("Partial Reads") {
+        db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28)");
+        db.exec("INSERT INTO dillydilly VALUES ('Drew Brees', 21)");
+        db.set_slow_query_log([&logged](const SlowQuery& query) { logged.push_back(query); },
+            options);
+
+        // Queries abandoned part way through are logged when closed...
+        auto results = db.query("SELECT * FROM dillydilly");
+        std::vector<std::string> row;
+        REQUIRE(results.next(row));
+        results.close();
+        REQUIRE(logged.size() == 1);
+
+        // ...replaced...
+        results = db.query("SELECT Player FROM dillydilly");
+        REQUIRE(results.next(row));
+        results = db.query("SELECT Touchdown FROM dillydilly");
+        REQUIRE(logged.size() == 2);
+        REQUIRE(logged[1].sql == "SELECT Player FROM dillydilly");
+
+        // ...or destroyed
+        {
+            auto partial = db.query("SELECT Touchdown FROM dillydilly");
+            REQUIRE(partial.next(row));
+        }
+
+        REQUIRE(logged.size() == 3);
+        REQUIRE(logged[2].elapsed.count() > 0);
+
+        // Unread queries have nothing to report
+        results.close();
+        REQUIRE(logged.size() == 3);
+    }
+
+    SECTION("Unredacted") {
+        options.redact = false;
+        options.explain = false;
+        db.set_slow_query_log([&logged](const SlowQuery& query) { logged.push_back(query); },
+            options);
+
+        auto stmt = db.prepare("INSERT INTO dillydilly VALUES (?, ?)");
+        stmt.bind("Tom Brady", 28);
+        stmt.commit();
+        REQUIRE(logged.size() == 1);
+        REQUIRE(logged[0].expanded_sql == "INSERT INTO dillydilly VALUES ('Tom Brady', 28)");
+        REQUIRE(logged[0].plan.empty());
+    }
+
+    SECTION("Threshold") {
+        options.threshold = std::chrono::hours(1);
+        db.set_slow_query_log([&logged](const SlowQuery& query) { logged.push_back(query); },
+            options);
+
+        auto results = db.query("SELECT * FROM dillydilly");
+        std::vector<std::string> row;
+        while (results.next(row));
+        REQUIRE(logged.empty());
+    }
+
+    SECTION("Disabled") {
+        db.set_slow_query_log([&logged](const SlowQuery& query) { logged.push_back(query); },
+            options);
+        db.set_slow_query_log(nullptr);
+
+        auto results = db.query("SELECT * FROM dillydilly");
+        std::vector<std::string> row;
+        while (results.next(row));
+        REQUIRE(logged.empty());
+    }
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
@@ -0,0 +1,138 @@
+#include "catch.hpp"
+#include "sqlite_cpp.h"
+
+using namespace SQLite;
+
+static long long int count_rows(SQLite::Conn& db) {
+    auto results = db.query("SELECT COUNT(*) FROM dillydilly");
+    RowView row;
+    results.next(row);
+    return row[0].get<long long int>();
+}
+
+/** Test committing and rolling back transactions and savepoints */
+TEST_CASE("Transaction Test", "[test_transaction]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT PRIMARY KEY, Touchdown int)");
+
+    SECTION("Many Statements, One Commit") {
+        auto txn = db.transaction(TransactionMode::IMMEDIATE);
+        REQUIRE_FALSE(txn.is_savepoint());
+
+        auto insert = db.prepare("INSERT INTO dillydilly VALUES (?, ?)");
+        auto update = db.prepare("UPDATE dillydilly SET Touchdown = Touchdown + 1");
+        insert.bind("Tom Brady", 28);
+        update.bind();
+        insert.bind("Drew Brees", 21);
+        insert.commit(); // Leaves txn alone
+        REQUIRE_FALSE(sqlite3_get_autocommit(db.get_ptr()));
+
+        txn.commit();
+        REQUIRE_FALSE(txn.is_active());
+        REQUIRE(sqlite3_get_autocommit(db.get_ptr()));
+        REQUIRE(count_rows(db) == 2);
+    }
+
+    SECTION("Rollback on Destruction") {
+        {
+            SQLite::Transaction txn(db, TransactionMode::EXCLUSIVE);
+            db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28)");
+        }
+
+        REQUIRE(sqlite3_get_autocommit(db.get_ptr()));
+        REQUIRE(count_rows(db) == 0);
+    }
+
+    SECTION("Savepoints") {
+        auto txn = db.transaction();
+        db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28)");
+        {
+            SQLite::Transaction savepoint(db);
+            REQUIRE(savepoint.is_savepoint());
+            db.exec("INSERT INTO dillydilly VALUES ('Drew Brees', 21)");
+
+            // Committing out of order is an error
+            REQUIRE_THROWS_AS(txn.commit(), ValueError);
+        }   // Only Drew Brees is rolled back
+
+        {
+            SQLite::Transaction savepoint(db);
+            db.exec("INSERT INTO dillydilly VALUES ('Cam Newton', 22)");
+            savepoint.commit();
+        }
+
+        REQUIRE(count_rows(db) == 2);
+        txn.rollback();
+        REQUIRE(count_rows(db) == 0);
+        REQUIRE_THROWS_AS(txn.commit(), ValueError);
+    }
+
+    SECTION("Repeated Transactions") {
+        // Control statements are prepared once and reused
+        for (int i = 0; i < 10; i++) {
+            auto txn = db.transaction(i % 2 ? TransactionMode::IMMEDIATE : TransactionMode::DEFERRED);
+            db.exec("INSERT INTO dillydilly VALUES ('Player " + std::to_string(i) + "', 1)");
+            SQLite::Transaction savepoint(db);
+            db.exec("INSERT INTO dillydilly VALUES ('Backup " + std::to_string(i) + "', 1)");
+            if (i % 2) savepoint.commit();
+            else savepoint.rollback();
+            txn.commit();
+        }
+
+        REQUIRE(count_rows(db) == 15);
+    }
+
+    SECTION("Failed Statement") {
+        auto txn = db.transaction();
+        auto stmt = db.prepare("INSERT INTO dillydilly VALUES (?, ?)");
+        stmt.bind("Tom Brady", 28);
+        REQUIRE_THROWS_AS(stmt.bind("Tom Brady", 28), SQLiteError);
+
+        // The transaction survives a failed statement
+        REQUIRE(txn.is_active());
+        txn.commit();
+        REQUIRE(count_rows(db) == 1);
+    }
+
+    SECTION("Without a Transaction") {
+        auto stmt = db.prepare("INSERT INTO dillydilly VALUES (?, ?)");
+        stmt.bind("Tom Brady", 28);
+        REQUIRE(sqlite3_get_autocommit(db.get_ptr())); // Already committed
+        REQUIRE_THROWS_AS(stmt.bind("Tom Brady", 28), SQLiteError);
+        stmt.commit();
+        REQUIRE(count_rows(db) == 1);
+    }
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test that BulkInsert writes savepoints inside an active transaction */
+TEST_CASE("Nested Bulk Insert Test", "[test_transaction_bulk]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT PRIMARY KEY, Touchdown int)");
+
+    {
+        auto txn = db.transaction();
+        {
+            auto loader = db.bulk_insert<std::string, int>("dillydilly");
+            loader.insert("Tom Brady", 28);
+            loader.commit();
+        }
+
+        {
+            auto loader = db.bulk_insert<std::string, int>("dillydilly");
+            loader.insert("Drew Brees", 21);
+            loader.insert("Tom Brady", 28);
+            REQUIRE_THROWS_AS(loader.commit(), SQLiteError);
+        }
+
+        REQUIRE(txn.is_active());
+        txn.commit();
+    }
+
+    REQUIRE(count_rows(db) == 1);
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
@@ -0,0 +1,60 @@
+#include "catch.hpp"
+#include "sqlite_cpp.h"
+
+using namespace SQLite;
+
+struct Player {
+    std::string name;
+    long long int touchdowns;
+    std::optional<double> rating;
+};
+
+template<>
+struct SQLite::RowMapping<Player> {
+    static constexpr auto members = std::make_tuple(
+        &Player::name, &Player::touchdowns, &Player::rating);
+};
+
+/** Test reading rows straight into tuples and structs */
+TEST_CASE("Typed Query Test", "[test_query_as]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE dillydilly (Player TEXT, Touchdown int, Rating real)");
+    db.exec("INSERT INTO dillydilly VALUES ('Tom Brady', 28, 102.8)");
+    db.exec("INSERT INTO dillydilly VALUES ('Drew Brees', 21, NULL)");
+
+    {
+        auto results = db.query_as<std::tuple<std::string_view, long long int, double>>(
+            "SELECT * FROM dillydilly");
+        std::tuple<std::string_view, long long int, double> row;
+
+        REQUIRE(results.next(row));
+        REQUIRE(std::get<0>(row) == "Tom Brady");
+        REQUIRE(std::get<1>(row) == 28);
+        REQUIRE(std::get<2>(row) == 102.8);
+        REQUIRE(results.next(row));
+        REQUIRE(std::get<2>(row) == 0);
+        REQUIRE_FALSE(results.next(row));
+    }
+
+    {
+        auto results = db.query_as<Player>("SELECT * FROM dillydilly");
+        Player row;
+
+        REQUIRE(results.next(row));
+        REQUIRE(row.name == "Tom Brady");
+        REQUIRE(row.touchdowns == 28);
+        REQUIRE(row.rating == 102.8);
+        REQUIRE(results.next(row));
+        REQUIRE(row.name == "Drew Brees");
+        REQUIRE_FALSE(row.rating.has_value());
+    }
+
+    {
+        auto results = db.query_as<std::tuple<int>>("SELECT * FROM dillydilly");
+        std::tuple<int> row;
+        REQUIRE_THROWS_AS(results.next(row), ValueError);
+    }
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
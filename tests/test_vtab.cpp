@@ -0,0 +1,156 @@
+#include "catch.hpp"
+#include "sqlite_vtab.h"
+
+using namespace SQLite;
+
+namespace {
+    struct Player {
+        long long int id;
+        std::string name;
+        double rating;
+    };
+}
+
+/** Test querying a std::vector through a virtual table */
+TEST_CASE("Virtual Table Test", "[test_vtab]") {
+    SQLite::Conn db("database.sqlite");
+    db.exec("CREATE TABLE teams (PlayerId int, Team TEXT)");
+    db.exec("INSERT INTO teams VALUES (2, 'Patriots')");
+    db.exec("INSERT INTO teams VALUES (500, 'Saints')");
+
+    std::vector<Player> players;
+    for (long long int i = 0; i < 1000; i++)
+        players.push_back({ i * 2, "Player " + std::to_string(i * 2), i / 10.0 });
+
+    // Counts how many rows' keys are read
+    size_t reads = 0;
+    SQLite::VirtualTableSpec<Player> spec;
+    spec.key("id", [&reads](const Player& player) { reads++; return player.id; })
+        .column("name", &Player::name)
+        .column("rating", &Player::rating);
+    SQLite::create_virtual_table(db, "players", players, spec);
+
+    auto count = [&db](const std::string& where) {
+        auto results = db.query("SELECT count(*) FROM players " + where);
+        RowView row;
+        results.next(row);
+        return row[0].get<long long int>();
+    };
+
+    SECTION("Full Scan") {
+        REQUIRE(count("") == 1000);
+        REQUIRE(count("WHERE rating >= 50") == 500);
+        REQUIRE(reads == 0);
+    }
+
+    SECTION("Equality") {
+        auto results = db.query("SELECT id, name, rating FROM players WHERE id = 28");
+        RowView row;
+        REQUIRE(results.next(row));
+        REQUIRE(row[0].get<long long int>() == 28);
+        REQUIRE(row[1].get<std::string_view>() == "Player 28");
+        REQUIRE(row[2].get<double>() == 1.4);
+        REQUIRE(!results.next(row));
+        REQUIRE(reads < 50);
+
+        REQUIRE(count("WHERE id = 27") == 0);
+        REQUIRE(count("WHERE id = -1") == 0);
+        REQUIRE(count("WHERE id = 5000") == 0);
+        REQUIRE(count("WHERE id = 28.0") == 1);
+        REQUIRE(count("WHERE id = '28'") == 1);
+        REQUIRE(count("WHERE id = 'Tom Brady'") == 0);
+        REQUIRE(count("WHERE id = NULL") == 0);
+    }
+
+    SECTION("Ranges") {
+        REQUIRE(count("WHERE id > 10 AND id < 20") == 4);
+        REQUIRE(count("WHERE id >= 10 AND id <= 20") == 6);
+        REQUIRE(count("WHERE id BETWEEN 10.5 AND 19.5") == 4);
+        REQUIRE(count("WHERE id < 10") == 5);
+        REQUIRE(count("WHERE id >= 1990") == 5);
+        REQUIRE(count("WHERE id > 20 AND id < 10") == 0);
+        REQUIRE(count("WHERE id = 12 AND id > 12") == 0);
+        REQUIRE(reads < 200);
+    }
+
+    SECTION("Order By Key") {
+        auto results = db.query("SELECT id FROM players WHERE id > 1990 ORDER BY id");
+        RowView row;
+        std::vector<long long int> ids;
+        while (results.next(row)) ids.push_back(row[0].get<long long int>());
+        REQUIRE(ids == std::vector<long long int>({ 1992, 1994, 1996, 1998 }));
+
+        results = db.query("SELECT id FROM players WHERE id > 1990 ORDER BY id DESC");
+        REQUIRE(results.next(row));
+        REQUIRE(row[0].get<long long int>() == 1998);
+    }
+
+    SECTION("Join") {
+        auto results = db.query("SELECT Team, name FROM teams "
+            "JOIN players ON players.id = teams.PlayerId ORDER BY Team");
+        RowView row;
+        REQUIRE(results.next(row));
+        REQUIRE(row[0].get<std::string_view>() == "Patriots");
+        REQUIRE(row[1].get<std::string_view>() == "Player 2");
+        REQUIRE(results.next(row));
+        REQUIRE(row[1].get<std::string_view>() == "Player 500");
+        REQUIRE(!results.next(row));
+        REQUIRE(reads < 100);
+    }
+
+    SECTION("Changes Are Visible") {
+        players.push_back({ 5000, "Tom Brady", 99 });
+        REQUIRE(count("WHERE id = 5000") == 1);
+    }
+
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}
+
+/** Test a text key and fixed size records viewed in place */
+TEST_CASE("Virtual Table Array Test", "[test_vtab_array]") {
+    struct Record {
+        char code[4];
+        int value;
+    };
+
+    const Record records[] = { { "AAA", 1 }, { "BBB", 2 }, { "BBB", 3 }, { "CCC", 4 } };
+    SQLite::ArrayView<Record> view{ records, 4 };
+
+    SQLite::Conn db("database.sqlite");
+    SQLite::VirtualTableSpec<Record> spec;
+    spec.key("code", [](const Record& record) { return std::string_view(record.code); })
+        .column("value", &Record::value);
+    SQLite::create_virtual_table(db, "records", view, spec);
+
+    auto results = db.query("SELECT sum(value) FROM records WHERE code = 'BBB'");
+    RowView row;
+    REQUIRE(results.next(row));
+    REQUIRE(row[0].get<long long int>() == 5);
+
+    results = db.query("SELECT group_concat(value) FROM records WHERE code > 'AAA' AND code < 'CCC'");
+    REQUIRE(results.next(row));
+    REQUIRE(row[0].get<std::string_view>() == "2,3");
+
+    results = db.query("SELECT count(*) FROM records WHERE code = 2");
+    REQUIRE(results.next(row));
+    REQUIRE(row[0].get<long long int>() == 0);
+
+    // Text constraints compare as text, not numbers
+    results = db.query("SELECT count(*) FROM records WHERE code < 'B'");
+    REQUIRE(results.next(row));
+    REQUIRE(row[0].get<long long int>() == 1);
+
+    // Constraints with another collation aren't narrowed byte by byte
+    results = db.query("SELECT sum(value) FROM records WHERE code = 'bbb' COLLATE NOCASE");
+    REQUIRE(results.next(row));
+    REQUIRE(row[0].get<long long int>() == 5);
+
+    results = db.query("SELECT count(*) FROM records WHERE code > 'b' COLLATE NOCASE");
+    REQUIRE(results.next(row));
+    REQUIRE(row[0].get<long long int>() == 3);
+
+    results.close();
+    db.close();
+    REQUIRE(remove("database.sqlite") == 0);
+}